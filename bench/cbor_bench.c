@@ -0,0 +1,937 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+/*
+ * Throughput benchmarks over synthetic corpora.
+ *
+ * Results are written to stdout as CSV, one line per benchmark and corpus:
+ *   benchmark,corpus,bytes,items,iterations,seconds,mb_per_s,items_per_s
+ * Pass a previous run with --baseline to compare against it; the exit code
+ * is 1 when any benchmark lost more than --threshold percent of throughput.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "cbor.h"
+#include "fp16.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INT_COUNT				(1 << 20)
+#define FLOAT_COUNT				(1 << 18)
+#define SHORT_ARRAY_COUNT		2048
+#define DEEP_COUNT				4096
+#define DEEP_DEPTH				48
+#define WIDE_MAP_KEYS			10000
+#define SMALL_MAP_KEYS			1000
+#define BLOB_COUNT				64
+#define BLOB_SIZE				(64 << 10)
+#define CHUNK_COUNT				4096
+#define CHUNK_SIZE				64
+#define TAGGED_COUNT			4096
+#define HALF_COUNT				(1 << 20)
+
+typedef struct
+{
+	const char *name;
+	uint8_t *buf;
+	size_t size;
+	size_t items;
+} corpus_t;
+
+typedef struct
+{
+	const char *name;
+	// corpus name, NULL runs the benchmark on every corpus
+	const char *corpus;
+	int (*run)(corpus_t *c, size_t *items);
+} bench_t;
+
+typedef struct
+{
+	char name[64];
+	char corpus[64];
+	double mb_per_s;
+} result_t;
+
+static uint64_t ints[INT_COUNT];
+static double floats[FLOAT_COUNT];
+static float features[HALF_COUNT];
+static half halfs[HALF_COUNT];
+static char keys[WIDE_MAP_KEYS][8];
+static uint8_t blob[BLOB_SIZE];
+static uint8_t *scratch;
+static size_t scratch_size;
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15;
+
+static uint64_t rng()
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* corpora */
+
+static int gen_flat_ints(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, INT_COUNT);
+	for (size_t i = 0; i < INT_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_uint(buf, size, pos, ints[i]);
+	}
+	*items = INT_COUNT;
+	return ret;
+}
+
+static int gen_small_ints(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, INT_COUNT);
+	for (size_t i = 0; i < INT_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_int(buf, size, pos, (int64_t)(ints[i] % 48) - 24);
+	}
+	*items = INT_COUNT;
+	return ret;
+}
+
+static int gen_short_array(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, SHORT_ARRAY_COUNT);
+	for (size_t i = 0; i < SHORT_ARRAY_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_uint(buf, size, pos, ints[i]);
+	}
+	*items = SHORT_ARRAY_COUNT;
+	return ret;
+}
+
+static int gen_deep(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, DEEP_COUNT);
+	for (size_t i = 0; i < DEEP_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		for (size_t j = 0; j < DEEP_DEPTH && ret == CBOR_NO_ERROR; j++)
+		{
+			ret = (j % 2) ? cbor_encode_array(buf, size, pos, 1) : cbor_encode_map(buf, size, pos, 1);
+			if (ret == CBOR_NO_ERROR && j % 2 == 0)
+			{
+				ret = cbor_encode_uint(buf, size, pos, j);
+			}
+		}
+
+		if (ret == CBOR_NO_ERROR)
+		{
+			ret = cbor_encode_uint(buf, size, pos, i);
+		}
+	}
+	*items = DEEP_COUNT * (DEEP_DEPTH + DEEP_DEPTH / 2 + 1);
+	return ret;
+}
+
+static int gen_map(uint8_t *buf, size_t size, size_t *pos, size_t *items, size_t count)
+{
+	int ret = cbor_encode_map(buf, size, pos, count);
+	for (size_t i = 0; i < count && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_string(buf, size, pos, keys[i]);
+		if (ret == CBOR_NO_ERROR)
+		{
+			ret = cbor_encode_uint(buf, size, pos, ints[i]);
+		}
+	}
+	*items = count << 1;
+	return ret;
+}
+
+static int gen_wide_map(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	return gen_map(buf, size, pos, items, WIDE_MAP_KEYS);
+}
+
+static int gen_small_map(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	return gen_map(buf, size, pos, items, SMALL_MAP_KEYS);
+}
+
+static int gen_blobs(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, BLOB_COUNT);
+	for (size_t i = 0; i < BLOB_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_bytes(buf, size, pos, blob, BLOB_SIZE);
+	}
+	*items = BLOB_COUNT;
+	return ret;
+}
+
+static int gen_floats(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_array(buf, size, pos, FLOAT_COUNT);
+	for (size_t i = 0; i < FLOAT_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_float(buf, size, pos, floats[i]);
+	}
+	*items = FLOAT_COUNT;
+	return ret;
+}
+
+static int gen_indef_string(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	int ret = cbor_encode_string_indef(buf, size, pos);
+	for (size_t i = 0; i < CHUNK_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_string(buf, size, pos, "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+	}
+
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_encode_break(buf, size, pos);
+	}
+	*items = CHUNK_COUNT;
+	return ret;
+}
+
+static int gen_tagged(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	// epoch timestamps, every other one a bignum-like nested tag
+	int ret = cbor_encode_array(buf, size, pos, TAGGED_COUNT);
+	for (size_t i = 0; i < TAGGED_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_encode_tag(buf, size, pos, 1);
+		if (ret == CBOR_NO_ERROR && i % 2)
+		{
+			ret = cbor_encode_tag(buf, size, pos, 2);
+		}
+
+		if (ret == CBOR_NO_ERROR)
+		{
+			ret = cbor_encode_uint(buf, size, pos, 1500000000 + ints[i] % 100000000);
+		}
+	}
+	*items = TAGGED_COUNT;
+	return ret;
+}
+
+static int gen_halfs(uint8_t *buf, size_t size, size_t *pos, size_t *items)
+{
+	*items = HALF_COUNT;
+	return cbor_encode_typed_array(buf, size, pos, TAG_TA_FLOAT16_LE, halfs, HALF_COUNT);
+}
+
+static struct
+{
+	const char *name;
+	int (*gen)(uint8_t *buf, size_t size, size_t *pos, size_t *items);
+} generators[] = {
+	{ "flat_ints", gen_flat_ints },
+	{ "small_ints", gen_small_ints },
+	{ "short_array", gen_short_array },
+	{ "deep", gen_deep },
+	{ "wide_map", gen_wide_map },
+	{ "small_map", gen_small_map },
+	{ "blobs", gen_blobs },
+	{ "floats", gen_floats },
+	{ "indef_string", gen_indef_string },
+	{ "tagged", gen_tagged },
+	{ "halfs", gen_halfs }
+};
+
+#define CORPUS_COUNT			(sizeof(generators) / sizeof(generators[0]))
+
+static corpus_t corpora[CORPUS_COUNT];
+
+static void init_sources()
+{
+	for (size_t i = 0; i < INT_COUNT; i++)
+	{
+		// every header width shows up
+		ints[i] = rng() >> (rng() % 64);
+	}
+
+	for (size_t i = 0; i < FLOAT_COUNT; i++)
+	{
+		// halves, floats and doubles in equal parts
+		floats[i] = (i % 3 == 0) ? (double)(rng() % 2048) / 8 \
+			: (i % 3 == 1) ? (double)(float)((double)rng() / 3e15) \
+			: (double)rng() / 7e15;
+	}
+
+	for (size_t i = 0; i < HALF_COUNT; i++)
+	{
+		// feature values around zero, every one exact in a half
+		features[i] = htof(ftoh((float)((double)(rng() % 65536) / 1024 - 32)));
+	}
+	floats_to_halfs(features, halfs, HALF_COUNT);
+
+	for (size_t i = 0; i < WIDE_MAP_KEYS; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "key%04zu", i);
+	}
+
+	for (size_t i = 0; i < BLOB_SIZE; i++)
+	{
+		blob[i] = (uint8_t)rng();
+	}
+}
+
+static int init_corpora()
+{
+	for (size_t i = 0; i < CORPUS_COUNT; i++)
+	{
+		// grow the buffer until the corpus fits
+		size_t size = 1 << 16;
+		for (;;)
+		{
+			uint8_t *buf = (uint8_t *)malloc(size);
+			if (buf == NULL)
+			{
+				return CBOR_ERR_OUT_OF_MEMORY;
+			}
+
+			size_t pos = 0;
+			int ret = generators[i].gen(buf, size, &pos, &corpora[i].items);
+			if (ret == CBOR_NO_ERROR)
+			{
+				corpora[i].name = generators[i].name;
+				corpora[i].buf = buf;
+				corpora[i].size = pos;
+				break;
+			}
+
+			free(buf);
+			if (ret != CBOR_ERR_OUT_OF_MEMORY)
+			{
+				return ret;
+			}
+			size <<= 1;
+		}
+
+		if (corpora[i].size > scratch_size)
+		{
+			scratch_size = corpora[i].size;
+		}
+	}
+
+	scratch = (uint8_t *)malloc(scratch_size);
+	return scratch != NULL ? CBOR_NO_ERROR : CBOR_ERR_OUT_OF_MEMORY;
+}
+
+/* benchmarks */
+
+static int bench_encode_uint(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	int ret = gen_flat_ints(scratch, scratch_size, &pos, items);
+	return ret;
+}
+
+static int bench_encode_int(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	int ret = gen_small_ints(scratch, scratch_size, &pos, items);
+	return ret;
+}
+
+static int bench_encode_float(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	return gen_floats(scratch, scratch_size, &pos, items);
+}
+
+static int bench_encode_bytes(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	return gen_blobs(scratch, scratch_size, &pos, items);
+}
+
+static int bench_encode_string(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	return gen_wide_map(scratch, scratch_size, &pos, items);
+}
+
+static int bench_encode_uint_array(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	*items = INT_COUNT;
+	return cbor_encode_uint_array(scratch, scratch_size, &pos, ints, INT_COUNT);
+}
+
+static int bench_encode_double_array(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	(void) c;
+	*items = FLOAT_COUNT;
+	return cbor_encode_double_array(scratch, scratch_size, &pos, floats, FLOAT_COUNT);
+}
+
+static int bench_encode_deterministic(corpus_t *c, size_t *items)
+{
+	// keys in reverse order, every map entry moves
+	static cbor_t desc[1 + WIDE_MAP_KEYS * 2];
+	size_t pos = 0;
+	(void) c;
+	desc[0].ct = CBOR_MAP;
+	desc[0].count = WIDE_MAP_KEYS * 2;
+	for (size_t i = 0; i < WIDE_MAP_KEYS; i++)
+	{
+		cbor_t *key = &desc[1 + i * 2], *val = key + 1;
+		key->ct = CBOR_STRING;
+		key->v.bytes = (const uint8_t *)keys[WIDE_MAP_KEYS - 1 - i];
+		key->size = strlen(keys[WIDE_MAP_KEYS - 1 - i]);
+		val->ct = CBOR_UINT;
+		val->v.uint = ints[i];
+	}
+	*items = WIDE_MAP_KEYS * 2;
+	return cbor_encode_deterministic(scratch, scratch_size, &pos, desc, 1 + WIDE_MAP_KEYS * 2);
+}
+
+static int bench_write_uint(corpus_t *c, size_t *items)
+{
+	cbor_writer_t writer;
+	(void) c;
+	int ret = cbor_writer_init_heap(&writer, 0);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_write_array(&writer, INT_COUNT);
+	}
+
+	for (size_t i = 0; i < INT_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_write_uint(&writer, ints[i]);
+	}
+	cbor_writer_free(&writer);
+	*items = INT_COUNT;
+	return ret;
+}
+
+static int bench_write_bytes_iovec(corpus_t *c, size_t *items)
+{
+	static cbor_iovec_t iov[BLOB_COUNT * 2 + 1];
+	cbor_writer_t writer;
+	size_t iovcnt;
+	(void) c;
+	int ret = cbor_writer_init_iovec(&writer, scratch, 1024, iov, BLOB_COUNT * 2 + 1, 4096);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_write_array(&writer, BLOB_COUNT);
+	}
+
+	for (size_t i = 0; i < BLOB_COUNT && ret == CBOR_NO_ERROR; i++)
+	{
+		ret = cbor_write_bytes(&writer, blob, BLOB_SIZE);
+	}
+
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_writer_iovec_finish(&writer, &iovcnt);
+	}
+	*items = BLOB_COUNT;
+	return ret;
+}
+
+static int bench_decode(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	cbor_free(cbor.next);
+	*items = c->items;
+	return ret;
+}
+
+// decodes every element of an array, tag nodes from the heap or from an arena
+static int __bench_decode_elements(corpus_t *c, size_t *items, cbor_arena_t *arena)
+{
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	pos = 0;
+	for (size_t i = 0; i < cbor.count && ret == CBOR_NO_ERROR; i++)
+	{
+		cbor_t val = { 0 };
+		if (arena != NULL)
+		{
+			ret = cbor_decode_arena(cbor.v.bytes, cbor.size, &pos, &val, arena);
+		}
+		else
+		{
+			ret = cbor_decode(cbor.v.bytes, cbor.size, &pos, &val);
+			cbor_free(val.next);
+		}
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_decode_elements(corpus_t *c, size_t *items)
+{
+	return __bench_decode_elements(c, items, NULL);
+}
+
+static int bench_decode_elements_arena(corpus_t *c, size_t *items)
+{
+	static uint8_t mem[TAGGED_COUNT * 2 * sizeof(cbor_t) + 64];
+	cbor_arena_t arena;
+	cbor_arena_init(&arena, mem, sizeof(mem));
+	int ret = __bench_decode_elements(c, items, &arena);
+	cbor_arena_reset(&arena);
+	return ret;
+}
+
+static int bench_well_formed(corpus_t *c, size_t *items)
+{
+	size_t err_pos;
+	*items = c->items;
+	return cbor_well_formed(c->buf, c->size, &err_pos);
+}
+
+static int bench_verify_canonical(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	*items = c->items;
+	return cbor_verify_canonical(c->buf, c->size, &pos);
+}
+
+static int bench_canonicalize(corpus_t *c, size_t *items)
+{
+	size_t pos = 0, out_pos = 0;
+	*items = c->items;
+	return cbor_canonicalize(c->buf, c->size, &pos, scratch, scratch_size, &out_pos);
+}
+
+static int bench_to_json(corpus_t *c, size_t *items)
+{
+	static cbor_writer_t writer;
+	if (writer.buf == NULL)
+	{
+		int ret = cbor_writer_init_heap(&writer, 1 << 20);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+
+	size_t pos = 0;
+	writer.pos = 0;
+	*items = c->items;
+	return cbor_to_json(c->buf, c->size, &pos, &writer);
+}
+
+static int bench_array_get(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	for (size_t i = 0; i < cbor.count && ret == CBOR_NO_ERROR; i++)
+	{
+		cbor_t val = { 0 };
+		ret = cbor_array_get(&cbor, i, &val);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_array_get_indexed(corpus_t *c, size_t *items)
+{
+	static size_t offsets[INT_COUNT];
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	cbor_array_index_t idx;
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_array_index(&cbor, &idx, offsets, INT_COUNT);
+	}
+
+	for (size_t i = 0; i < cbor.count && ret == CBOR_NO_ERROR; i++)
+	{
+		cbor_t val = { 0 };
+		ret = cbor_array_get(&cbor, i, &val);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_array_to_u64(corpus_t *c, size_t *items)
+{
+	static uint64_t vals[INT_COUNT];
+	size_t pos = 0, count;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_array_to_u64(&cbor, vals, INT_COUNT, &count);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_array_to_i64(corpus_t *c, size_t *items)
+{
+	static int64_t vals[INT_COUNT];
+	size_t pos = 0, count;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_array_to_i64(&cbor, vals, INT_COUNT, &count);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_array_to_double(corpus_t *c, size_t *items)
+{
+	static double vals[FLOAT_COUNT];
+	size_t pos = 0, count;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_array_to_double(&cbor, vals, FLOAT_COUNT, &count);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_halfs_to_floats(corpus_t *c, size_t *items)
+{
+	static half vals[HALF_COUNT];
+	static float dest[HALF_COUNT];
+	size_t pos = 0, count = 0;
+	cbor_t cbor = { 0 };
+	cbor_typed_array_t ta;
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_typed_array_get(&cbor, &ta);
+	}
+
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_typed_array_copy(&ta, vals, HALF_COUNT, &count);
+	}
+
+	if (ret == CBOR_NO_ERROR)
+	{
+		halfs_to_floats(vals, dest, count);
+	}
+	cbor_free(cbor.next);
+	*items = count;
+	return ret;
+}
+
+static int bench_floats_to_halfs(corpus_t *c, size_t *items)
+{
+	static half vals[HALF_COUNT];
+	size_t pos = 0;
+	(void) c;
+	floats_to_halfs(features, vals, HALF_COUNT);
+	*items = HALF_COUNT;
+	return cbor_encode_typed_array(scratch, scratch_size, &pos, TAG_TA_FLOAT16_LE, vals, HALF_COUNT);
+}
+
+static int bench_map_get(corpus_t *c, size_t *items)
+{
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	for (size_t i = 0; i < cbor.count >> 1 && ret == CBOR_NO_ERROR; i++)
+	{
+		cbor_t val = { 0 };
+		ret = cbor_map_get(&cbor, keys[i], &val);
+	}
+	*items = cbor.count >> 1;
+	return ret;
+}
+
+static int bench_map_get_indexed(corpus_t *c, size_t *items)
+{
+	static cbor_map_slot_t slots[WIDE_MAP_KEYS * 2];
+	size_t pos = 0;
+	cbor_t cbor = { 0 };
+	cbor_map_index_t idx;
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_map_index(&cbor, &idx, slots, WIDE_MAP_KEYS * 2);
+	}
+
+	for (size_t i = 0; i < cbor.count >> 1 && ret == CBOR_NO_ERROR; i++)
+	{
+		cbor_t val = { 0 };
+		ret = cbor_map_get(&cbor, keys[i], &val);
+	}
+	*items = cbor.count >> 1;
+	return ret;
+}
+
+static int bench_bytes_len(corpus_t *c, size_t *items)
+{
+	size_t pos = 0, len;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_bytes_len(&cbor, &len);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_bytes_copy(corpus_t *c, size_t *items)
+{
+	size_t pos = 0, len;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_bytes_copy(scratch, &cbor, scratch_size, &len);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static int bench_bytes_compare(corpus_t *c, size_t *items)
+{
+	size_t pos = 0, len;
+	int res;
+	cbor_t cbor = { 0 };
+	int ret = cbor_decode(c->buf, c->size, &pos, &cbor);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_bytes_copy(scratch, &cbor, scratch_size, &len);
+	}
+
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_bytes_compare(&cbor, scratch, len, &res);
+	}
+	*items = cbor.count;
+	return ret;
+}
+
+static const bench_t benches[] = {
+	{ "encode_uint", "flat_ints", bench_encode_uint },
+	{ "encode_int", "small_ints", bench_encode_int },
+	{ "encode_float", "floats", bench_encode_float },
+	{ "encode_bytes", "blobs", bench_encode_bytes },
+	{ "encode_string", "wide_map", bench_encode_string },
+	{ "encode_uint_array", "flat_ints", bench_encode_uint_array },
+	{ "encode_double_array", "floats", bench_encode_double_array },
+	{ "encode_deterministic", "wide_map", bench_encode_deterministic },
+	{ "write_uint", "flat_ints", bench_write_uint },
+	{ "write_bytes_iovec", "blobs", bench_write_bytes_iovec },
+	{ "decode", NULL, bench_decode },
+	{ "decode_elements", "tagged", bench_decode_elements },
+	{ "decode_elements_arena", "tagged", bench_decode_elements_arena },
+	{ "well_formed", NULL, bench_well_formed },
+	{ "verify_canonical", "flat_ints", bench_verify_canonical },
+	{ "verify_canonical", "wide_map", bench_verify_canonical },
+	{ "verify_canonical", "floats", bench_verify_canonical },
+	{ "canonicalize", "wide_map", bench_canonicalize },
+	{ "canonicalize", "indef_string", bench_canonicalize },
+	{ "to_json", NULL, bench_to_json },
+	{ "array_get", "short_array", bench_array_get },
+	{ "array_get_indexed", "flat_ints", bench_array_get_indexed },
+	{ "array_to_u64", "flat_ints", bench_array_to_u64 },
+	{ "array_to_i64", "small_ints", bench_array_to_i64 },
+	{ "array_to_double", "floats", bench_array_to_double },
+	{ "halfs_to_floats", "halfs", bench_halfs_to_floats },
+	{ "floats_to_halfs", "halfs", bench_floats_to_halfs },
+	{ "map_get", "small_map", bench_map_get },
+	{ "map_get_indexed", "wide_map", bench_map_get_indexed },
+	{ "bytes_len", "indef_string", bench_bytes_len },
+	{ "bytes_copy", "indef_string", bench_bytes_copy },
+	{ "bytes_compare", "indef_string", bench_bytes_compare }
+};
+
+/* driver */
+
+static size_t load_baseline(const char *path, result_t *results, size_t cap)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "cannot open baseline %s\n", path);
+		return 0;
+	}
+
+	size_t len = 0;
+	char line[512];
+	while (len < cap && fgets(line, sizeof(line), fp) != NULL)
+	{
+		result_t *r = &results[len];
+		if (sscanf(line, "%63[^,],%63[^,],%*[^,],%*[^,],%*[^,],%*[^,],%lf", r->name, r->corpus, &r->mb_per_s) == 3)
+		{
+			len++;
+		}
+	}
+	fclose(fp);
+	return len;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [--filter NAME] [--min-time SEC] [--baseline CSV] [--threshold PCT] [--dump DIR]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = NULL, *baseline = NULL, *dump = NULL;
+	double min_time = 0.2, threshold = 10.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+		{
+			min_time = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+		{
+			baseline = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--dump") && i + 1 < argc)
+		{
+			dump = argv[++i];
+		}
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	init_sources();
+	int ret = init_corpora();
+	if (ret != CBOR_NO_ERROR)
+	{
+		fprintf(stderr, "corpus generation failed: %s\n", cbor_get_error(ret));
+		return 2;
+	}
+
+	if (dump != NULL)
+	{
+		for (size_t i = 0; i < CORPUS_COUNT; i++)
+		{
+			char path[512];
+			snprintf(path, sizeof(path), "%s/%s.cbor", dump, corpora[i].name);
+			FILE *fp = fopen(path, "wb");
+			if (fp == NULL || fwrite(corpora[i].buf, 1, corpora[i].size, fp) != corpora[i].size)
+			{
+				fprintf(stderr, "cannot write %s\n", path);
+				return 2;
+			}
+			fclose(fp);
+		}
+		return 0;
+	}
+
+	static result_t base[256];
+	size_t base_len = baseline != NULL ? load_baseline(baseline, base, 256) : 0;
+	int regressions = 0;
+
+	printf("benchmark,corpus,bytes,items,iterations,seconds,mb_per_s,items_per_s\n");
+	for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++)
+	{
+		if (filter != NULL && strstr(benches[b].name, filter) == NULL)
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < CORPUS_COUNT; i++)
+		{
+			corpus_t *c = &corpora[i];
+			if (benches[b].corpus != NULL && strcmp(benches[b].corpus, c->name))
+			{
+				continue;
+			}
+
+			size_t items = 0, iterations = 0;
+			double start = now(), elapsed;
+			do
+			{
+				ret = benches[b].run(c, &items);
+				iterations++;
+				elapsed = now() - start;
+			} while (ret == CBOR_NO_ERROR && elapsed < min_time);
+
+			if (ret != CBOR_NO_ERROR)
+			{
+				fprintf(stderr, "%s/%s failed: %s\n", benches[b].name, c->name, cbor_get_error(ret));
+				return 2;
+			}
+
+			double mb_per_s = (double)c->size * iterations / elapsed / 1e6;
+			printf("%s,%s,%zu,%zu,%zu,%.6f,%.2f,%.0f\n", benches[b].name, c->name, c->size, items, \
+				iterations, elapsed, mb_per_s, (double)items * iterations / elapsed);
+			fflush(stdout);
+
+			for (size_t j = 0; j < base_len; j++)
+			{
+				if (!strcmp(base[j].name, benches[b].name) && !strcmp(base[j].corpus, c->name) && base[j].mb_per_s > 0)
+				{
+					double change = (mb_per_s / base[j].mb_per_s - 1) * 100;
+					bool regressed = change < -threshold;
+					fprintf(stderr, "%-20s %-14s %10.2f -> %10.2f MB/s %+7.1f%%%s\n", benches[b].name, c->name, \
+						base[j].mb_per_s, mb_per_s, change, regressed ? "  REGRESSION" : "");
+					regressions += regressed;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < CORPUS_COUNT; i++)
+	{
+		free(corpora[i].buf);
+	}
+	free(scratch);
+	return regressions > 0 ? 1 : 0;
+}
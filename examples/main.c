@@ -23,6 +23,7 @@
 ****************************************************************************/
 
 #include "cbor.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -44,10 +45,10 @@ void print_cbor(cbor_t *val)
 			break;
 		case CBOR_SIMPLE:
 		case CBOR_UINT:
-			printf("%u", val->v.uint);
+			printf("%" PRIu64, val->v.uint);
 			break;
 		case CBOR_NEGINT:
-			printf("%d", val->v.sint);
+			printf("%" PRId64, val->v.sint);
 			break;
 		case CBOR_FLOAT:
 			printf("%f", val->v.flt);
@@ -56,7 +57,7 @@ void print_cbor(cbor_t *val)
 			printf("%f", val->v.dbl);
 			break;
 		case CBOR_TAG:
-			printf("%u(", val->v.uint);
+			printf("%" PRIu64 "(", val->v.uint);
 			print_cbor(val->next);
 			printf(")");
 			break;
@@ -69,6 +70,7 @@ void print_cbor(cbor_t *val)
 			if (bytes == NULL)
 			{
 				printf("[Fatal] Out of memory!\n");
+				break;
 			}
 
 			size_t copied_len;
@@ -99,11 +101,12 @@ void print_cbor(cbor_t *val)
 			if (str == NULL)
 			{
 				printf("[Fatal] Out of memory!\n");
+				break;
 			}
 
 			size_t copied_len;
 			cbor_bytes_copy(str, val, len, &copied_len);
-			str[copied_len - 1] = '\0';
+			str[copied_len] = '\0';
 			printf("\"%s\"", str);
 
 			free(str);
@@ -175,7 +178,7 @@ int main()
 	cbor_encode_break(buf, size, &pos);					// end indefinite-length map
 	
 	printf("[CBOR]: \n");
-	for (int i = 0; i < pos; i++)
+	for (size_t i = 0; i < pos; i++)
 	{
 		printf("%02x", buf[i]);
 	}
@@ -187,10 +190,10 @@ int main()
 
 	size_t err_pos = 0;
 	cbor_t *cbor = cbor_create();
-	int ret = cbor_decode(buf, size, &err_pos, cbor);
+	int ret = cbor_decode(buf, pos, &err_pos, cbor);
 	if (ret != CBOR_NO_ERROR)
 	{
-		printf("pos = %d, errno = %d, errText = %s\n", err_pos, ret, cbor_get_error(ret));
+		printf("pos = %zu, errno = %d, errText = %s\n", err_pos, ret, cbor_get_error(ret));
 		return 1;
 	}
 
@@ -246,7 +249,7 @@ int main()
 	cbor_map_get(cbor, "array", val);
 	printf(", \"array\": [");
 
-	for (int i = 0; i < val->count; i++)
+	for (size_t i = 0; i < val->count; i++)
 	{
 		cbor_array_get(val, i, subval);
 		if (i > 0)
@@ -265,4 +268,28 @@ int main()
 	cbor_free(val);
 
 	cbor_free(cbor);
+
+
+	// 3. converting to JSON text
+	printf("\n[cbor_to_json]: \n");
+
+	err_pos = 0;
+	cbor_writer_t writer;
+	ret = cbor_writer_init_heap(&writer, 256);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_to_json(buf, pos, &err_pos, &writer);
+	}
+
+	if (ret != CBOR_NO_ERROR)
+	{
+		printf("pos = %zu, errno = %d, errText = %s\n", err_pos, ret, cbor_get_error(ret));
+		cbor_writer_free(&writer);
+		return 1;
+	}
+
+	printf("%.*s\n", (int)writer.pos, (const char *)writer.buf);
+
+	cbor_writer_free(&writer);
+	return 0;
 }
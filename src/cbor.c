@@ -25,9 +25,53 @@
 #include "cbor.h"
 #include <stdlib.h>
 
+static void *__cbor_malloc(void *ctx, size_t size)
+{
+	(void) ctx;
+	return malloc(size);
+}
+
+static void *__cbor_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	(void) ctx;
+	(void) old_size;
+	return realloc(ptr, size);
+}
+
+static void __cbor_mfree(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	(void) size;
+	free(ptr);
+}
+
+static const cbor_allocator_t __cbor_default_allocator = { __cbor_malloc, __cbor_realloc, __cbor_mfree, NULL };
+static cbor_allocator_t __cbor_allocator = { __cbor_malloc, __cbor_realloc, __cbor_mfree, NULL };
+
+void cbor_set_allocator(const cbor_allocator_t *allocator)
+{
+	__cbor_allocator = allocator != NULL ? *allocator : __cbor_default_allocator;
+}
+
+const cbor_allocator_t *cbor_get_allocator()
+{
+	return &__cbor_allocator;
+}
+
 cbor_t *cbor_create()
 {
-	cbor_t *cbor = (cbor_t *)malloc(sizeof(cbor_t));
+	return cbor_create_with(NULL);
+}
+
+void cbor_free(cbor_t *cbor)
+{
+	cbor_free_with(cbor, NULL);
+}
+
+cbor_t *cbor_create_with(const cbor_allocator_t *allocator)
+{
+	allocator = allocator != NULL ? allocator : &__cbor_allocator;
+	cbor_t *cbor = (cbor_t *)allocator->alloc(allocator->ctx, sizeof(cbor_t));
 	if (cbor != NULL)
 	{
 		memset(cbor, 0, sizeof(cbor_t));
@@ -35,17 +79,77 @@ cbor_t *cbor_create()
 	return cbor;
 }
 
-void cbor_free(cbor_t *cbor)
+void cbor_free_with(cbor_t *cbor, const cbor_allocator_t *allocator)
 {
-	if (cbor != NULL)
+	allocator = allocator != NULL ? allocator : &__cbor_allocator;
+	while (cbor != NULL)
 	{
-		if (cbor->next != NULL)
-		{
-			cbor_free(cbor->next);
-			cbor->next = NULL;
-		}
-		free(cbor);
+		cbor_t *next = cbor->next;
+		cbor->next = NULL;
+		allocator->free(allocator->ctx, cbor, sizeof(cbor_t));
+		cbor = next;
+	}
+}
+
+#define CBOR_ARENA_ALIGN			16
+
+void cbor_arena_init(cbor_arena_t *arena, void *buf, size_t size)
+{
+	arena->buf = (uint8_t *)buf;
+	arena->size = size;
+	arena->used = 0;
+	arena->allocator = NULL;
+}
+
+int cbor_arena_init_heap(cbor_arena_t *arena, size_t size)
+{
+	return cbor_arena_init_heap_with(arena, size, NULL);
+}
+
+int cbor_arena_init_heap_with(cbor_arena_t *arena, size_t size, const cbor_allocator_t *allocator)
+{
+	allocator = allocator != NULL ? allocator : &__cbor_allocator;
+	cbor_arena_init(arena, allocator->alloc(allocator->ctx, size), size);
+	if (arena->buf == NULL)
+	{
+		arena->size = 0;
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	arena->allocator = allocator;
+	return CBOR_NO_ERROR;
+}
+
+void *cbor_arena_alloc(cbor_arena_t *arena, size_t size)
+{
+	if (arena->buf == NULL)
+	{
+		return NULL;
+	}
+
+	size_t pad = (CBOR_ARENA_ALIGN - ((uintptr_t)(arena->buf + arena->used) & (CBOR_ARENA_ALIGN - 1))) & (CBOR_ARENA_ALIGN - 1);
+	if (arena->size - arena->used < pad || arena->size - arena->used - pad < size)
+	{
+		return NULL;
 	}
+
+	void *ptr = arena->buf + arena->used + pad;
+	arena->used += pad + size;
+	return ptr;
+}
+
+void cbor_arena_reset(cbor_arena_t *arena)
+{
+	arena->used = 0;
+}
+
+void cbor_arena_free(cbor_arena_t *arena)
+{
+	if (arena->allocator != NULL)
+	{
+		arena->allocator->free(arena->allocator->ctx, arena->buf, arena->size);
+	}
+	cbor_arena_init(arena, NULL, 0);
 }
 
 int cbor_bytes_len(cbor_t *cbor, size_t *len)
@@ -91,7 +195,9 @@ int cbor_bytes_compare(cbor_t *cbor, const void *buf, size_t size, int *res)
 	}
 	else if (cbor->ct == CBOR_BYTES_INDEF || cbor->ct == CBOR_STRING_INDEF)
 	{
-		for (size_t i = 0, pos1 = 0, pos2 = 0; i < cbor->count && pos2 < size; i++)
+		size_t pos2 = 0;
+		*res = 0;
+		for (size_t i = 0, pos1 = 0; i < cbor->count && !*res; i++)
 		{
 			cbor_t chunk;
 			int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos1, &chunk);
@@ -100,17 +206,18 @@ int cbor_bytes_compare(cbor_t *cbor, const void *buf, size_t size, int *res)
 				return ret;
 			}
 
-			ret = cbor_bytes_compare(&chunk, buf + pos2, chunk.size, res);
-			if (ret != CBOR_NO_ERROR)
+			size_t len = chunk.size > size - pos2 ? size - pos2 : chunk.size;
+			*res = memcmp(chunk.v.bytes, (const uint8_t *)buf + pos2, len);
+			if (!*res && len < chunk.size)
 			{
-				return ret;
+				*res = 1;
 			}
+			pos2 += len;
+		}
 
-			if (*res)
-			{
-				break;
-			}
-			pos2 += chunk.size;
+		if (!*res && pos2 < size)
+		{
+			*res = -1;
 		}
 		return CBOR_NO_ERROR;
 	}
@@ -177,6 +284,46 @@ int cbor_chunk_get(cbor_t *cbor, size_t index, cbor_t *val)
 	return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
 }
 
+// find the element offset, recording the offsets of the elements skipped on the way
+static int __cbor_array_seek(cbor_t *cbor, size_t index, size_t *pos)
+{
+	cbor_array_index_t *idx = (cbor_array_index_t *)cbor->index;
+	if (idx->built == 0 && idx->capacity > 0)
+	{
+		idx->offsets[0] = 0;
+		idx->built = 1;
+	}
+
+	if (index < idx->built)
+	{
+		*pos = idx->offsets[index];
+		return CBOR_NO_ERROR;
+	}
+
+	size_t i = 0;
+	*pos = 0;
+	if (idx->built > 0)
+	{
+		i = idx->built - 1;
+		*pos = idx->offsets[i];
+	}
+
+	while (i < index)
+	{
+		int ret = cbor_verify(cbor->v.bytes, cbor->size, pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (++i == idx->built && i < idx->capacity)
+		{
+			idx->offsets[idx->built++] = *pos;
+		}
+	}
+	return CBOR_NO_ERROR;
+}
+
 int cbor_array_get(cbor_t *cbor, size_t index, cbor_t *val)
 {
 	if (cbor->ct != CBOR_ARRAY)
@@ -190,6 +337,16 @@ int cbor_array_get(cbor_t *cbor, size_t index, cbor_t *val)
 	}
 
 	size_t pos = 0;
+	if (cbor->index != NULL)
+	{
+		int ret = __cbor_array_seek(cbor, index, &pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+		return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
+	}
+
 	for (size_t i = 0; i < index; i++)
 	{
 		int ret = cbor_verify(cbor->v.bytes, cbor->size, &pos);
@@ -201,17 +358,369 @@ int cbor_array_get(cbor_t *cbor, size_t index, cbor_t *val)
 	return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
 }
 
+int cbor_array_index(cbor_t *cbor, cbor_array_index_t *idx, size_t *offsets, size_t cap)
+{
+	if (cbor->ct != CBOR_ARRAY)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	idx->offsets = offsets;
+	idx->capacity = cap;
+	idx->built = 0;
+	cbor->index = idx;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_array_index_build(cbor_t *cbor)
+{
+	if (cbor->ct != CBOR_ARRAY || cbor->index == NULL)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	size_t pos = 0;
+	return cbor->count > 0 ? __cbor_array_seek(cbor, cbor->count - 1, &pos) : CBOR_NO_ERROR;
+}
+
+#define FNV_OFFSET_BASIS		2166136261u
+#define FNV_PRIME				16777619u
+
+#define ARRAY_TO_U64				0
+#define ARRAY_TO_I64				1
+#define ARRAY_TO_DOUBLE				2
+#define ARRAY_TO_RUN				64
+
+// decodes up to n integers sharing the initial byte at *pos, or the major type for immediate arguments
+static size_t __cbor_int_run(const uint8_t *buf, size_t size, size_t *pos, uint64_t *vals, size_t n)
+{
+	const uint8_t *p = buf + *pos;
+	uint8_t ib = *p;
+	size_t i = 0;
+	if ((ib & 0x1f) < AI_1)
+	{
+		n = n < size - *pos ? n : size - *pos;
+		for (; i < n && (p[i] & 0xe0) == (ib & 0xe0) && (p[i] & 0x1f) < AI_1; i++)
+		{
+			vals[i] = p[i] & 0x1f;
+		}
+		*pos += i;
+		return i;
+	}
+
+	size_t len = (ib & 0x1f) == AI_1 ? 1 \
+		: (ib & 0x1f) == AI_2 ? 2 \
+		: (ib & 0x1f) == AI_4 ? 4 \
+		: 8;
+	size_t avail = (size - *pos) / (len + 1);
+	n = n < avail ? n : avail;
+
+	// fixed stride within the run, one loop per width
+	if (len == 1)
+	{
+		for (; i < n && p[0] == ib; i++, p += 2)
+		{
+			vals[i] = p[1];
+		}
+	}
+	else if (len == 2)
+	{
+		for (; i < n && p[0] == ib; i++, p += 3)
+		{
+			vals[i] = nbtos(p + 1);
+		}
+	}
+	else if (len == 4)
+	{
+		for (; i < n && p[0] == ib; i++, p += 5)
+		{
+			vals[i] = nbtol(p + 1);
+		}
+	}
+	else
+	{
+		for (; i < n && p[0] == ib; i++, p += 9)
+		{
+			vals[i] = nbtoll(p + 1);
+		}
+	}
+
+	*pos += i * (len + 1);
+	return i;
+}
+
+// converts a run of integers of major type ib_mt in place, or into dbl
+static int __cbor_int_run_convert(int kind, uint8_t ib_mt, uint64_t *vals, double *dbl, size_t n)
+{
+	if (kind == ARRAY_TO_U64)
+	{
+		return ib_mt == IB_UINT ? CBOR_NO_ERROR : CBOR_ERR_MT_MISMATCH;
+	}
+	else if (kind == ARRAY_TO_I64)
+	{
+		uint64_t high = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			high |= vals[i];
+			vals[i] = ib_mt == IB_UINT ? vals[i] : ~vals[i];
+		}
+		return (high >> 63) ? CBOR_ERR_MT_MISMATCH : CBOR_NO_ERROR;
+	}
+	else // if (kind == ARRAY_TO_DOUBLE)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			dbl[i] = ib_mt == IB_UINT ? (double)vals[i] : -1.0 - (double)vals[i];
+		}
+		return CBOR_NO_ERROR;
+	}
+}
+
+static int __cbor_array_to(cbor_t *cbor, int kind, void *dest, size_t cap, size_t *count)
+{
+	if (cbor->ct != CBOR_ARRAY)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	uint64_t run[ARRAY_TO_RUN];
+	const uint8_t *buf = cbor->v.bytes;
+	size_t n = cbor->count < cap ? cbor->count : cap;
+	size_t pos = 0;
+	size_t i = 0;
+	while (i < n)
+	{
+		int ret;
+		uint8_t ib_mt = buf[pos] & 0xe0;
+		if ((ib_mt == IB_UINT || ib_mt == IB_NEGINT) && (buf[pos] & 0x1f) <= AI_8)
+		{
+			// integers land in place, only doubles go through the run buffer
+			uint64_t *vals = kind == ARRAY_TO_DOUBLE ? run : (uint64_t *)dest + i;
+			size_t max = kind == ARRAY_TO_DOUBLE && n - i > ARRAY_TO_RUN ? ARRAY_TO_RUN : n - i;
+			size_t len = __cbor_int_run(buf, cbor->size, &pos, vals, max);
+			if (len > 0)
+			{
+				ret = __cbor_int_run_convert(kind, ib_mt, vals, (double *)dest + i, len);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+
+				i += len;
+				continue;
+			}
+		}
+
+		cbor_t val = { 0 };
+		ret = cbor_decode(buf, cbor->size, &pos, &val);
+		cbor_free(val.next);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (kind == ARRAY_TO_DOUBLE && (val.ct == CBOR_FLOAT || val.ct == CBOR_DOUBLE))
+		{
+			((double *)dest)[i++] = val.ct == CBOR_FLOAT ? val.v.flt : val.v.dbl;
+		}
+		else
+		{
+			return CBOR_ERR_MT_MISMATCH;
+		}
+	}
+
+	*count = n;
+	return n == cbor->count ? CBOR_NO_ERROR : CBOR_ERR_OUT_OF_MEMORY;
+}
+
+int cbor_array_to_u64(cbor_t *cbor, uint64_t *dest, size_t cap, size_t *count)
+{
+	return __cbor_array_to(cbor, ARRAY_TO_U64, dest, cap, count);
+}
+
+int cbor_array_to_i64(cbor_t *cbor, int64_t *dest, size_t cap, size_t *count)
+{
+	return __cbor_array_to(cbor, ARRAY_TO_I64, dest, cap, count);
+}
+
+int cbor_array_to_double(cbor_t *cbor, double *dest, size_t cap, size_t *count)
+{
+	return __cbor_array_to(cbor, ARRAY_TO_DOUBLE, dest, cap, count);
+}
+
+static uint32_t __cbor_hash_bytes(uint32_t hash, const void *buf, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ p[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint32_t __cbor_hash_int(cbor_type ct, uint64_t val)
+{
+	uint8_t bytes[9];
+	bytes[0] = (uint8_t)ct;
+	lltonb(val, bytes + 1);
+	return __cbor_hash_bytes(FNV_OFFSET_BASIS, bytes, sizeof(bytes));
+}
+
+// hash a string or integer key, strings hash the same regardless of chunking
+static int __cbor_hash_key(cbor_t *key, uint32_t *hash)
+{
+	if (key->ct == CBOR_STRING)
+	{
+		*hash = __cbor_hash_bytes(FNV_OFFSET_BASIS, key->v.bytes, key->size);
+		return CBOR_NO_ERROR;
+	}
+	else if (key->ct == CBOR_STRING_INDEF)
+	{
+		*hash = FNV_OFFSET_BASIS;
+		for (size_t i = 0, pos = 0; i < key->count; i++)
+		{
+			cbor_t chunk;
+			int ret = cbor_decode(key->v.bytes, key->size, &pos, &chunk);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			*hash = __cbor_hash_bytes(*hash, chunk.v.bytes, chunk.size);
+		}
+		return CBOR_NO_ERROR;
+	}
+	else if (key->ct == CBOR_UINT || key->ct == CBOR_NEGINT)
+	{
+		*hash = __cbor_hash_int(key->ct, key->v.uint);
+		return CBOR_NO_ERROR;
+	}
+	return CBOR_ERR_MT_MISMATCH;
+}
+
+int cbor_map_index(cbor_t *cbor, cbor_map_index_t *idx, cbor_map_slot_t *slots, size_t cap)
+{
+	if (cbor->ct != CBOR_MAP)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	size_t capacity = 1;
+	while (capacity <= cap >> 1)
+	{
+		capacity <<= 1;
+	}
+
+	if (cap == 0 || capacity <= cbor->count >> 1)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	memset(slots, 0, sizeof(cbor_map_slot_t) * capacity);
+	for (size_t i = 0, pos = 0; i < cbor->count; i += 2)
+	{
+		size_t key = pos;
+		cbor_t _key = { 0 };
+		int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos, &_key);
+		cbor_free(_key.next);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		// keys of other types can not be looked up, equal keys keep insertion order along the probe sequence
+		uint32_t hash;
+		if (__cbor_hash_key(&_key, &hash) == CBOR_NO_ERROR)
+		{
+			size_t j = hash & (capacity - 1);
+			while (slots[j].value != 0)
+			{
+				j = (j + 1) & (capacity - 1);
+			}
+
+			slots[j].hash = hash;
+			slots[j].key = key;
+			slots[j].value = pos;
+		}
+
+		ret = cbor_verify(cbor->v.bytes, cbor->size, &pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+
+	idx->slots = slots;
+	idx->capacity = capacity;
+	cbor->index = idx;
+	return CBOR_NO_ERROR;
+}
+
+// probe the map index for a key equal to the given string or integer
+static int __cbor_map_index_get(cbor_t *cbor, cbor_type ct, const char *key, size_t len, uint64_t ival, cbor_t *val)
+{
+	cbor_map_index_t *idx = (cbor_map_index_t *)cbor->index;
+	uint32_t hash = ct == CBOR_STRING ? __cbor_hash_bytes(FNV_OFFSET_BASIS, key, len) : __cbor_hash_int(ct, ival);
+	for (size_t j = hash & (idx->capacity - 1); idx->slots[j].value != 0; j = (j + 1) & (idx->capacity - 1))
+	{
+		if (idx->slots[j].hash != hash)
+		{
+			continue;
+		}
+
+		size_t pos = idx->slots[j].key;
+		cbor_t _key = { 0 };
+		int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos, &_key);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		int res = 1;
+		if (ct == CBOR_STRING && (_key.ct == CBOR_STRING || _key.ct == CBOR_STRING_INDEF))
+		{
+			ret = cbor_bytes_compare(&_key, key, len, &res);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+		else if (ct == _key.ct && ct != CBOR_STRING)
+		{
+			res = _key.v.uint != ival;
+		}
+
+		if (!res)
+		{
+			pos = idx->slots[j].value;
+			return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
+		}
+	}
+	return CBOR_ERR_MAP_KEY_MISMATCH;
+}
+
 int cbor_map_get(cbor_t *cbor, const char *key, cbor_t *val)
+{
+	return cbor_map_get_n(cbor, key, strlen(key), val);
+}
+
+int cbor_map_get_n(cbor_t *cbor, const char *key, size_t len, cbor_t *val)
 {
 	if (cbor->ct != CBOR_MAP)
 	{
 		return CBOR_ERR_MT_MISMATCH;
 	}
 
+	if (cbor->index != NULL)
+	{
+		return __cbor_map_index_get(cbor, CBOR_STRING, key, len, 0, val);
+	}
+
 	for (size_t i = 0, pos = 0; i < cbor->count; i += 2)
 	{
-		cbor_t _key;
+		cbor_t _key = { 0 };
 		int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos, &_key);
+		cbor_free(_key.next);
 		if (ret != CBOR_NO_ERROR)
 		{
 			return ret;
@@ -219,7 +728,7 @@ int cbor_map_get(cbor_t *cbor, const char *key, cbor_t *val)
 
 		if (_key.ct == CBOR_STRING)
 		{
-			if (_key.size == strlen(key) && !memcmp(_key.v.str, key, _key.size))
+			if (_key.size == len && !memcmp(_key.v.str, key, _key.size))
 			{
 				return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
 			}
@@ -227,7 +736,7 @@ int cbor_map_get(cbor_t *cbor, const char *key, cbor_t *val)
 		else if (_key.ct == CBOR_STRING_INDEF)
 		{
 			int res = 0;
-			ret = cbor_bytes_compare(&_key, key, strlen(key), &res);
+			ret = cbor_bytes_compare(&_key, key, len, &res);
 			if (ret != CBOR_NO_ERROR)
 			{
 				return ret;
@@ -247,3 +756,182 @@ int cbor_map_get(cbor_t *cbor, const char *key, cbor_t *val)
 	}
 	return CBOR_ERR_MAP_KEY_MISMATCH;
 }
+
+int cbor_map_get_int(cbor_t *cbor, int64_t key, cbor_t *val)
+{
+	if (cbor->ct != CBOR_MAP)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	cbor_type ct = key < 0 ? CBOR_NEGINT : CBOR_UINT;
+	if (cbor->index != NULL)
+	{
+		return __cbor_map_index_get(cbor, ct, NULL, 0, (uint64_t)key, val);
+	}
+
+	for (size_t i = 0, pos = 0; i < cbor->count; i += 2)
+	{
+		cbor_t _key = { 0 };
+		int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos, &_key);
+		cbor_free(_key.next);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (_key.ct == ct && _key.v.sint == key)
+		{
+			return cbor_decode(cbor->v.bytes, cbor->size, &pos, val);
+		}
+
+		ret = cbor_verify(cbor->v.bytes, cbor->size, &pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+	return CBOR_ERR_MAP_KEY_MISMATCH;
+}
+
+#define GET_MANY_SLOTS			128
+#define GET_MANY_FOUND			0xff
+
+// match a decoded map key against one requested key
+static int __cbor_key_match(cbor_t *_key, const cbor_key_t *key, int *res)
+{
+	if (_key->ct == CBOR_STRING)
+	{
+		*res = !(_key->size == key->len && !memcmp(_key->v.str, key->str, key->len));
+		return CBOR_NO_ERROR;
+	}
+	return cbor_bytes_compare(_key, key->str, key->len, res);
+}
+
+// walk the map once for up to GET_MANY_SLOTS / 2 requested keys
+static int __cbor_map_get_batch(cbor_t *cbor, const cbor_key_t *keys, size_t n, cbor_t *vals, size_t *found)
+{
+	uint8_t slots[GET_MANY_SLOTS];
+	uint32_t hashes[GET_MANY_SLOTS >> 1];
+	size_t mask = 1;
+	while (mask < n << 1)
+	{
+		mask <<= 1;
+	}
+	mask--;
+
+	memset(slots, 0, mask + 1);
+	for (size_t k = 0; k < n; k++)
+	{
+		hashes[k] = __cbor_hash_bytes(FNV_OFFSET_BASIS, keys[k].str, keys[k].len);
+		size_t j = hashes[k] & mask;
+		while (slots[j] != 0)
+		{
+			j = (j + 1) & mask;
+		}
+		slots[j] = (uint8_t)(k + 1);
+	}
+
+	size_t left = n;
+	for (size_t i = 0, pos = 0; i < cbor->count && left > 0; i += 2)
+	{
+		cbor_t _key = { 0 };
+		int ret = cbor_decode(cbor->v.bytes, cbor->size, &pos, &_key);
+		cbor_free(_key.next);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (_key.ct == CBOR_STRING || _key.ct == CBOR_STRING_INDEF)
+		{
+			uint32_t hash;
+			ret = __cbor_hash_key(&_key, &hash);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			// requested keys may repeat, every copy receives the value; matched slots become tombstones
+			for (size_t j = hash & mask; slots[j] != 0; j = (j + 1) & mask)
+			{
+				size_t k = (size_t)slots[j] - 1;
+				if (slots[j] == GET_MANY_FOUND || hashes[k] != hash)
+				{
+					continue;
+				}
+
+				int res = 0;
+				ret = __cbor_key_match(&_key, &keys[k], &res);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+
+				if (!res)
+				{
+					size_t _pos = pos;
+					ret = cbor_decode(cbor->v.bytes, cbor->size, &_pos, &vals[k]);
+					if (ret != CBOR_NO_ERROR)
+					{
+						return ret;
+					}
+
+					slots[j] = GET_MANY_FOUND;
+					++*found;
+					--left;
+				}
+			}
+		}
+
+		ret = cbor_verify(cbor->v.bytes, cbor->size, &pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+	return CBOR_NO_ERROR;
+}
+
+int cbor_map_get_many(cbor_t *cbor, const cbor_key_t *keys, size_t n, cbor_t *vals, size_t *found)
+{
+	if (cbor->ct != CBOR_MAP)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	*found = 0;
+	for (size_t k = 0; k < n; k++)
+	{
+		vals[k].ct = CBOR_UNDEFINED;
+	}
+
+	if (cbor->index != NULL)
+	{
+		for (size_t k = 0; k < n; k++)
+		{
+			int ret = __cbor_map_index_get(cbor, CBOR_STRING, keys[k].str, keys[k].len, 0, &vals[k]);
+			if (ret == CBOR_NO_ERROR)
+			{
+				++*found;
+			}
+			else if (ret != CBOR_ERR_MAP_KEY_MISMATCH)
+			{
+				return ret;
+			}
+		}
+	}
+	else
+	{
+		for (size_t k = 0; k < n; k += GET_MANY_SLOTS >> 1)
+		{
+			size_t cnt = n - k > (GET_MANY_SLOTS >> 1) ? (GET_MANY_SLOTS >> 1) : n - k;
+			int ret = __cbor_map_get_batch(cbor, keys + k, cnt, vals + k, found);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+	}
+	return *found == n ? CBOR_NO_ERROR : CBOR_ERR_MAP_KEY_MISMATCH;
+}
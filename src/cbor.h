@@ -50,6 +50,38 @@ extern "C" {
 #define AI_INDEF											31
 #define AI_BRKCD											0xFF
 
+// RFC 8949 tags with a JSON mapping, see cbor_to_json()
+#define TAG_POS_BIGNUM										2
+#define TAG_NEG_BIGNUM										3
+#define TAG_BASE64URL										21
+#define TAG_BASE64											22
+#define TAG_BASE16											23
+
+// RFC 8746 typed arrays, tag bits 010fsell: float, signed, little endian, log2 of the width
+#define TAG_TA_UINT8										64
+#define TAG_TA_UINT16_BE									65
+#define TAG_TA_UINT32_BE									66
+#define TAG_TA_UINT64_BE									67
+#define TAG_TA_UINT8_CLAMPED								68
+#define TAG_TA_UINT16_LE									69
+#define TAG_TA_UINT32_LE									70
+#define TAG_TA_UINT64_LE									71
+#define TAG_TA_SINT8										72
+#define TAG_TA_SINT16_BE									73
+#define TAG_TA_SINT32_BE									74
+#define TAG_TA_SINT64_BE									75
+#define TAG_TA_SINT16_LE									77
+#define TAG_TA_SINT32_LE									78
+#define TAG_TA_SINT64_LE									79
+#define TAG_TA_FLOAT16_BE									80
+#define TAG_TA_FLOAT32_BE									81
+#define TAG_TA_FLOAT64_BE									82
+#define TAG_TA_FLOAT128_BE									83
+#define TAG_TA_FLOAT16_LE									84
+#define TAG_TA_FLOAT32_LE									85
+#define TAG_TA_FLOAT64_LE									86
+#define TAG_TA_FLOAT128_LE									87
+
 #define AI_FALSE											20	
 #define AI_TRUE												21
 #define AI_NULL												22
@@ -69,6 +101,20 @@ extern "C" {
 #define CBOR_ERR_MT_MISMATCH								11
 #define CBOR_ERR_ARRAY_INDEX_OUT_OF_BOUNDS					12
 #define CBOR_ERR_MAP_KEY_MISMATCH							13
+#define CBOR_ERR_END_OF_CONTAINER							14
+#define CBOR_ERR_DEPTH_EXCEEDED								15
+#define CBOR_ERR_IO											16
+#define CBOR_ERR_INVALID_TAG_CONTENT						17
+#define CBOR_ERR_DUPLICATE_KEY								18
+#define CBOR_ERR_NOT_DETERMINISTIC							19
+
+// nesting limit of the reader, stream and event parsers; cbor_verify() keeps this many frames on the C stack
+#ifndef CBOR_MAX_DEPTH
+#define CBOR_MAX_DEPTH										64
+#endif
+
+/** Item count reported for indefinite-length arrays and maps that have not been walked */
+#define CBOR_COUNT_INDEF									((size_t)-1)
 
 typedef enum
 {
@@ -121,27 +167,292 @@ typedef struct _cbor_t
 	size_t size;
 	size_t count;
 	struct _cbor_t *next;
+	/** Optional lookup index attached to an array or map, NULL if none */
+	void *index;
 } cbor_t;
 
+/** Element offsets of an array, see cbor_array_index() */
+typedef struct _cbor_array_index_t
+{
+	/** Element offsets, relative to the array payload */
+	size_t *offsets;
+	/** Number of entries available in offsets */
+	size_t capacity;
+	/** Number of leading elements whose offsets are known */
+	size_t built;
+} cbor_array_index_t;
+
+/** Hash slot of a map index */
+typedef struct _cbor_map_slot_t
+{
+	/** Hash of the key */
+	uint32_t hash;
+	/** Key offset, relative to the map payload */
+	size_t key;
+	/** Value offset, relative to the map payload, 0 for an empty slot */
+	size_t value;
+} cbor_map_slot_t;
+
+/** Open-addressing hash table over the string and integer keys of a map, see cbor_map_index() */
+typedef struct _cbor_map_index_t
+{
+	cbor_map_slot_t *slots;
+	/** Number of slots in use, a power of two */
+	size_t capacity;
+} cbor_map_index_t;
+
+/** Nesting level of an array, map, tag or indefinite-length string being walked */
+typedef struct _cbor_frame_t
+{
+	/** Major type of the container */
+	uint8_t ib_mt;
+	/** Terminated by a break code */
+	bool indef;
+	/** Items left in a definite-length container */
+	uint64_t remaining;
+	/** Items seen so far */
+	uint64_t count;
+} cbor_frame_t;
+
+/** Pull-style cursor over a buffer, see cbor_reader_next() */
+typedef struct _cbor_reader_t
+{
+	const uint8_t *buf;
+	size_t size;
+	size_t pos;
+	/** The last item returned is a container or tag that has been neither entered nor skipped */
+	bool pending;
+	cbor_frame_t head;
+	/** Number of containers entered, stack[depth] is the current one */
+	size_t depth;
+	/** The top level and up to CBOR_MAX_DEPTH nested levels */
+	cbor_frame_t stack[CBOR_MAX_DEPTH + 1];
+} cbor_reader_t;
+
+/** Resumable well-formedness check over a message arriving in pieces, see cbor_stream_feed() */
+typedef struct _cbor_stream_t
+{
+	/** Header bytes of the item being read */
+	uint8_t head[9];
+	size_t head_len;
+	/** Payload bytes of the current string still to come */
+	uint64_t skip;
+	/** Bytes of the message consumed so far */
+	size_t total;
+	size_t depth;
+	/** The top level and up to CBOR_MAX_DEPTH nested levels */
+	cbor_frame_t stack[CBOR_MAX_DEPTH + 1];
+} cbor_stream_t;
+
+/** Handlers of cbor_parse_events(), any may be NULL; an error code returned by a handler stops the parse */
+typedef struct _cbor_callbacks_t
+{
+	int (*on_uint)(void *ctx, uint64_t val);
+	int (*on_negint)(void *ctx, int64_t val);
+	/** last is false while more chunks of an indefinite-length byte string follow */
+	int (*on_bytes)(void *ctx, const uint8_t *bytes, size_t len, bool last);
+	/** last is false while more chunks of an indefinite-length string follow */
+	int (*on_string_chunk)(void *ctx, const char *str, size_t len, bool last);
+	/** count is CBOR_COUNT_INDEF for indefinite-length arrays */
+	int (*on_array_start)(void *ctx, size_t count);
+	int (*on_array_end)(void *ctx);
+	/** count of keys and values, CBOR_COUNT_INDEF for indefinite-length maps */
+	int (*on_map_start)(void *ctx, size_t count);
+	int (*on_map_end)(void *ctx);
+	/** the tagged item is reported next */
+	int (*on_tag)(void *ctx, uint64_t tag);
+	/** half, float and double */
+	int (*on_float)(void *ctx, double val);
+	/** false, true, null, undefined and the other simple values */
+	int (*on_simple)(void *ctx, uint8_t val);
+} cbor_callbacks_t;
+
+/** Key of a batched map lookup, see cbor_map_get_many() */
+typedef struct _cbor_key_t
+{
+	const char *str;
+	size_t len;
+} cbor_key_t;
+
+/** Structural index record of one item, as filled by cbor_parse_tape() */
+typedef struct _cbor_node_t
+{
+	/** Type of the item */
+	cbor_type ct;
+	/** Offset of the initial byte */
+	size_t head;
+	/** Offset of the payload, right after the header */
+	size_t payload;
+	/** Number of child items of an array, map, tag or indefinite-length string */
+	size_t count;
+	/** Offset right after the item, including its break code */
+	size_t end;
+	/** Tape index of the next sibling, right after the subtree of this item */
+	size_t next;
+} cbor_node_t;
+
+/** Elements of an RFC 8746 typed array, see cbor_typed_array_get() */
+typedef struct _cbor_typed_array_t
+{
+	/** TAG_TA_* */
+	uint64_t tag;
+	/** Elements as encoded, not necessarily aligned */
+	const uint8_t *data;
+	size_t count;
+	/** Element size in bytes */
+	size_t width;
+	bool is_float;
+	bool is_signed;
+	/** Elements are in host byte order and can be read in place */
+	bool native;
+} cbor_typed_array_t;
+
+/** Memory functions of the library, see cbor_set_allocator() and the *_with() variants */
+typedef struct _cbor_allocator_t
+{
+	void *(*alloc)(void *ctx, size_t size);
+	/** old_size is the size ptr was allocated or last resized with */
+	void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t size);
+	/** size is the size ptr was allocated or last resized with */
+	void (*free)(void *ctx, void *ptr, size_t size);
+	void *ctx;
+} cbor_allocator_t;
+
+/** Bump allocator for the nodes of decoded trees, see cbor_decode_arena() */
+typedef struct _cbor_arena_t
+{
+	uint8_t *buf;
+	size_t size;
+	size_t used;
+	/** Owner of buf, NULL for a caller buffer, see cbor_arena_init_heap() */
+	const cbor_allocator_t *allocator;
+} cbor_arena_t;
+
+/** Scatter-gather entry, laid out like struct iovec so an array of them can be passed to writev() */
+typedef struct _cbor_iovec_t
+{
+	void *iov_base;
+	size_t iov_len;
+} cbor_iovec_t;
+
+/** Output of the cbor_write_*() family, see cbor_writer_init() and friends */
+typedef struct _cbor_writer_t
+{
+	uint8_t *buf;
+	size_t size;
+	size_t pos;
+	/** Makes room for need more bytes after pos, the sink policy */
+	int (*reserve)(struct _cbor_writer_t *writer, size_t need);
+	/** Receives the written bytes of a flushing writer, NULL otherwise */
+	int (*flush)(void *ctx, const uint8_t *buf, size_t len);
+	void *ctx;
+	/** Owner of buf of a heap writer */
+	const cbor_allocator_t *allocator;
+	/** File descriptor of cbor_writer_init_fd() */
+	int fd;
+	/** Bytes handed to flush so far, the message length is flushed + pos */
+	size_t flushed;
+	/** Scatter-gather list of cbor_writer_init_iovec(), NULL otherwise */
+	cbor_iovec_t *iov;
+	size_t iov_cap;
+	size_t iov_len;
+	/** Payloads of at least this many bytes are referenced in iov instead of being copied */
+	size_t iov_threshold;
+	/** Start of the bytes in buf not yet referenced by iov */
+	size_t iov_mark;
+} cbor_writer_t;
+
+
+// allocator used when none is passed, NULL restores malloc(), realloc() and free(); the struct is copied,
+// set it before anything is allocated
+void cbor_set_allocator(const cbor_allocator_t *allocator);
+const cbor_allocator_t *cbor_get_allocator();
 
 cbor_t *cbor_create();
 void cbor_free(cbor_t *cbor);
+// the same with an allocator, NULL for the global one; a tree must be freed with the allocator it was decoded with
+cbor_t *cbor_create_with(const cbor_allocator_t *allocator);
+void cbor_free_with(cbor_t *cbor, const cbor_allocator_t *allocator);
+
+const char *cbor_get_error(int err);
 
-const char *cbor_get_error(int errno);
+// arena over a caller buffer, allocations fail once it is used up
+void cbor_arena_init(cbor_arena_t *arena, void *buf, size_t size);
+// arena over a heap buffer of size bytes, release with cbor_arena_free()
+int cbor_arena_init_heap(cbor_arena_t *arena, size_t size);
+int cbor_arena_init_heap_with(cbor_arena_t *arena, size_t size, const cbor_allocator_t *allocator);
+void *cbor_arena_alloc(cbor_arena_t *arena, size_t size);
+// drops every allocation at once
+void cbor_arena_reset(cbor_arena_t *arena);
+void cbor_arena_free(cbor_arena_t *arena);
 
 int cbor_verify(const uint8_t *buf, size_t size, size_t *pos);
+// containers and tags nest at most max_depth levels below the item, the item itself is not counted;
+// cbor_verify() has no limit, frames beyond CBOR_MAX_DEPTH come from cbor_get_allocator()
+int cbor_verify_depth(const uint8_t *buf, size_t size, size_t *pos, size_t max_depth);
 int cbor_verify_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag);
 int cbor_well_formed(const uint8_t *buf, size_t size, size_t *err_pos);
+// the item is in the form cbor_encode_deterministic() writes: shortest headers and floats, no indefinite
+// lengths, map keys in bytewise order; otherwise *pos is left at the offending item or key with
+// CBOR_ERR_NOT_DETERMINISTIC or CBOR_ERR_DUPLICATE_KEY
+int cbor_verify_canonical(const uint8_t *buf, size_t size, size_t *pos);
+// copies the item to out in that form, rewriting it when cbor_verify_canonical() fails; keys that become
+// equal give CBOR_ERR_DUPLICATE_KEY, scratch memory comes from the allocator, NULL for the global one
+int cbor_canonicalize(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out, size_t out_size, size_t *out_pos);
+int cbor_canonicalize_with(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out, size_t out_size, size_t *out_pos, const cbor_allocator_t *allocator);
 
 int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor);
 int cbor_decode_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag, cbor_t *cbor);
+// like cbor_decode() with tag nodes taken from arena, the tree must not be passed to cbor_free()
+int cbor_decode_arena(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, cbor_arena_t *arena);
+// like cbor_decode() with tag nodes taken from allocator, release the tree with cbor_free_with()
+int cbor_decode_with(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, const cbor_allocator_t *allocator);
+int cbor_read_header(const uint8_t *buf, size_t size, size_t *pos, uint8_t *ib_mt, uint8_t *ib_ai, uint64_t *val);
+
+// a tape of (size - *pos) nodes is always large enough
+int cbor_parse_tape(const uint8_t *buf, size_t size, size_t *pos, cbor_node_t *tape, size_t cap, size_t *len);
+int cbor_tape_get(const uint8_t *buf, const cbor_node_t *tape, size_t len, size_t index, cbor_t *cbor);
+int cbor_tape_child(const cbor_node_t *tape, size_t len, size_t index, size_t n, size_t *child);
+
+// element width of a typed array tag, 0 for other tags
+size_t cbor_typed_array_width(uint64_t tag);
+// view of a decoded typed array tag, the content must be a definite-length byte string
+int cbor_typed_array_get(const cbor_t *cbor, cbor_typed_array_t *ta);
+// copies up to cap elements into dest in host byte order
+int cbor_typed_array_copy(const cbor_typed_array_t *ta, void *dest, size_t cap, size_t *count);
 
 int cbor_bytes_len(cbor_t *cbor, size_t *len);
 int cbor_bytes_compare(cbor_t *cbor, const void *buf, size_t size, int *res);
 int cbor_bytes_copy(void *dest, cbor_t *src, size_t size, size_t *len);
 int cbor_chunk_get(cbor_t *cbor, size_t index, cbor_t *val);
 int cbor_array_get(cbor_t *cbor, size_t index, cbor_t *val);
+int cbor_array_index(cbor_t *cbor, cbor_array_index_t *idx, size_t *offsets, size_t cap);
+int cbor_array_index_build(cbor_t *cbor);
+// fill dest with the first cap elements of an array, CBOR_ERR_MT_MISMATCH for elements that do not convert;
+// integers convert to double, CBOR_ERR_OUT_OF_MEMORY if the array has more than cap elements
+int cbor_array_to_u64(cbor_t *cbor, uint64_t *dest, size_t cap, size_t *count);
+int cbor_array_to_i64(cbor_t *cbor, int64_t *dest, size_t cap, size_t *count);
+int cbor_array_to_double(cbor_t *cbor, double *dest, size_t cap, size_t *count);
 int cbor_map_get(cbor_t *cbor, const char *key, cbor_t *val);
+int cbor_map_get_n(cbor_t *cbor, const char *key, size_t len, cbor_t *val);
+int cbor_map_get_int(cbor_t *cbor, int64_t key, cbor_t *val);
+// values of keys not found are left as CBOR_UNDEFINED
+int cbor_map_get_many(cbor_t *cbor, const cbor_key_t *keys, size_t n, cbor_t *vals, size_t *found);
+// cap should be at least twice the number of key/value pairs
+int cbor_map_index(cbor_t *cbor, cbor_map_index_t *idx, cbor_map_slot_t *slots, size_t cap);
+
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *buf, size_t size);
+// arrays, maps and tags are returned by their header, enter or skip them next
+int cbor_reader_next(cbor_reader_t *reader, cbor_t *item);
+int cbor_reader_enter_container(cbor_reader_t *reader);
+int cbor_reader_leave_container(cbor_reader_t *reader);
+int cbor_reader_skip(cbor_reader_t *reader);
+
+int cbor_parse_events(const uint8_t *buf, size_t size, size_t *pos, const cbor_callbacks_t *cb, void *ctx);
+
+void cbor_stream_init(cbor_stream_t *stream);
+// CBOR_ERR_OUT_OF_DATA asks for at least *need more bytes, call cbor_stream_init() again after a complete item
+int cbor_stream_feed(cbor_stream_t *stream, const uint8_t *buf, size_t size, size_t *pos, size_t *need);
 
 // 0. ensure buffer capacity
 bool ensure_capacity(const uint8_t *buf, size_t size, size_t offset);
@@ -173,6 +484,92 @@ int cbor_encode_map(uint8_t *buf, size_t size, size_t *pos, size_t len);
 int cbor_encode_map_indef(uint8_t *buf, size_t size, size_t *pos);
 // 14. encode break code
 int cbor_encode_break(uint8_t *buf, size_t size, size_t *pos);
+// 15. encode initial byte and argument, ib_mt is one of IB_*
+int cbor_encode_header(uint8_t *buf, size_t size, size_t *pos, uint8_t ib_mt, uint64_t val);
+// 16. encoded sizes, in bytes, of what the functions above write
+size_t cbor_encoded_size_header(uint64_t val);
+size_t cbor_encoded_size_int(int64_t val);
+size_t cbor_encoded_size_uint(uint64_t val);
+size_t cbor_encoded_size_simple(uint8_t val);
+size_t cbor_encoded_size_float(double val);
+size_t cbor_encoded_size_bytes(size_t len);
+size_t cbor_encoded_size_string(const char *str);
+size_t cbor_encoded_size_array(size_t len);
+size_t cbor_encoded_size_map(size_t len);
+// 17. encoded size of a document given as its items in pre-order: containers are followed by their
+//     count children (keys and values for maps), tags by one item, indefinite-length strings by count chunks
+int cbor_encoded_size_items(const cbor_t *items, size_t n, size_t *size);
+// 18. encode a document given as its items in pre-order, see cbor_encoded_size_items()
+int cbor_encode_items(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n);
+// 19. encode array of unsigned integers, nothing is written when it does not fit
+int cbor_encode_uint_array(uint8_t *buf, size_t size, size_t *pos, const uint64_t *vals, size_t n);
+// 20. encode array of signed integers
+int cbor_encode_int_array(uint8_t *buf, size_t size, size_t *pos, const int64_t *vals, size_t n);
+// 21. encode array of doubles, each in the shortest of half, float and double
+int cbor_encode_double_array(uint8_t *buf, size_t size, size_t *pos, const double *vals, size_t n);
+// 22. encode typed array from count elements in host byte order, swapped if the tag says otherwise
+int cbor_encode_typed_array(uint8_t *buf, size_t size, size_t *pos, uint64_t tag, const void *data, size_t count);
+// 23. encode items like cbor_encode_items() in deterministic encoding (RFC 8949 4.2.1): map entries are sorted
+//     by the bytes of their keys, CBOR_ERR_DUPLICATE_KEY for equal keys, CBOR_ERR_NOT_DETERMINISTIC for
+//     indefinite-length strings; scratch memory comes from the allocator, NULL for the global one
+int cbor_encode_deterministic(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n);
+int cbor_encode_deterministic_with(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n, const cbor_allocator_t *allocator);
+
+// fixed buffer, writes fail with CBOR_ERR_OUT_OF_MEMORY once it is full
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buf, size_t size);
+// heap buffer growing geometrically, release with cbor_writer_free()
+int cbor_writer_init_heap(cbor_writer_t *writer, size_t size);
+int cbor_writer_init_heap_with(cbor_writer_t *writer, size_t size, const cbor_allocator_t *allocator);
+// buffer of at least 9 bytes handed to flush whenever it fills up and by cbor_writer_flush()
+int cbor_writer_init_flush(cbor_writer_t *writer, uint8_t *buf, size_t size, int (*flush)(void *ctx, const uint8_t *buf, size_t len), void *ctx);
+#if defined(__unix__) || defined(__APPLE__)
+// flushing writer over write(2), failures are reported as CBOR_ERR_IO
+int cbor_writer_init_fd(cbor_writer_t *writer, uint8_t *buf, size_t size, int fd);
+#endif
+// headers and short payloads go to buf, payloads of at least threshold bytes are referenced in place,
+// they must outlive the writer; call cbor_writer_iovec_finish() for the entry count
+int cbor_writer_init_iovec(cbor_writer_t *writer, uint8_t *buf, size_t size, cbor_iovec_t *iov, size_t cap, size_t threshold);
+int cbor_writer_iovec_finish(cbor_writer_t *writer, size_t *iovcnt);
+int cbor_writer_flush(cbor_writer_t *writer);
+void cbor_writer_free(cbor_writer_t *writer);
+
+int cbor_write_int(cbor_writer_t *writer, int64_t val);
+int cbor_write_uint(cbor_writer_t *writer, uint64_t val);
+int cbor_write_tag(cbor_writer_t *writer, uint64_t val);
+int cbor_write_simple(cbor_writer_t *writer, uint8_t val);
+int cbor_write_float(cbor_writer_t *writer, double val);
+int cbor_write_bytes(cbor_writer_t *writer, const uint8_t *bytes, size_t len);
+int cbor_write_bytes_indef(cbor_writer_t *writer);
+int cbor_write_string(cbor_writer_t *writer, const char *str);
+int cbor_write_string_n(cbor_writer_t *writer, const char *str, size_t len);
+int cbor_write_string_indef(cbor_writer_t *writer);
+int cbor_write_array(cbor_writer_t *writer, size_t len);
+int cbor_write_array_indef(cbor_writer_t *writer);
+int cbor_write_map(cbor_writer_t *writer, size_t len);
+int cbor_write_map_indef(cbor_writer_t *writer);
+int cbor_write_break(cbor_writer_t *writer);
+// copies an already encoded item
+int cbor_write_raw(cbor_writer_t *writer, const uint8_t *buf, size_t len);
+// see cbor_encode_typed_array(), elements in host byte order are passed through like cbor_write_bytes()
+int cbor_write_typed_array(cbor_writer_t *writer, uint64_t tag, const void *data, size_t count);
+// indefinite-length string of chunks of at most chunk bytes, read stores the count in *got, 0 at the end;
+// text is cut at UTF-8 sequence boundaries and chunk is raised to at least 4 bytes for it; a writer without
+// room for the longest header and a minimal chunk, such as a 9-byte flush buffer, gives CBOR_ERR_OUT_OF_MEMORY
+int cbor_write_bytes_stream(cbor_writer_t *writer, int (*read)(void *ctx, uint8_t *buf, size_t len, size_t *got), void *ctx, size_t chunk);
+int cbor_write_string_stream(cbor_writer_t *writer, int (*read)(void *ctx, uint8_t *buf, size_t len, size_t *got), void *ctx, size_t chunk);
+#if defined(__unix__) || defined(__APPLE__)
+// the same over read(2) until end of file, failures are reported as CBOR_ERR_IO
+int cbor_write_bytes_fd(cbor_writer_t *writer, int fd, size_t chunk);
+int cbor_write_string_fd(cbor_writer_t *writer, int fd, size_t chunk);
+#endif
+
+// JSON text of the item at *pos following RFC 8949 6.1: byte strings in base64url or the encoding of an
+// enclosing tag 21 to 23, bignums as base64url strings, other tags dropped, non-finite floats, undefined and
+// other simple values as null, other floats with the fewest digits that read back the same laid out as
+// JSON.stringify() does, both zeros as 0, keys other than strings quoted; a container as key gives
+// CBOR_ERR_MT_MISMATCH; runs of string bytes may be referenced in place by an iovec writer, the output is
+// incomplete on error
+int cbor_to_json(const uint8_t *buf, size_t size, size_t *pos, cbor_writer_t *writer);
 
 #ifdef __cplusplus
 }
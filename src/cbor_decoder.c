@@ -23,6 +23,7 @@
 ****************************************************************************/
 
 #include "cbor.h"
+#include "cbor_header.h"
 #include "fp16.h"
 #include "endian.h"
 #include <math.h>
@@ -30,35 +31,47 @@
 #include <string.h>
 #include <stdlib.h>
 
+static void *__cbor_arena_alloc(void *ctx, size_t size)
+{
+	return cbor_arena_alloc((cbor_arena_t *)ctx, size);
+}
+
+// arena nodes go away with the next reset
+static void __cbor_arena_free(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	(void) ptr;
+	(void) size;
+}
+
 int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 {
-	if (buf[*pos] == AI_BRKCD)
+	return __cbor_decode(buf, size, pos, cbor, cbor_get_allocator());
+}
+
+int cbor_decode_arena(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, cbor_arena_t *arena)
+{
+	cbor_allocator_t allocator = { __cbor_arena_alloc, NULL, __cbor_arena_free, arena };
+	return __cbor_decode(buf, size, pos, cbor, &allocator);
+}
+
+int cbor_decode_with(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, const cbor_allocator_t *allocator)
+{
+	return __cbor_decode(buf, size, pos, cbor, allocator != NULL ? allocator : cbor_get_allocator());
+}
+
+int __cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, const cbor_allocator_t *allocator)
+{
+	uint8_t ib_mt, ib_ai;
+	uint64_t val;
+	int ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+	if (ret != CBOR_NO_ERROR)
 	{
-		return CBOR_ERR_BREAK_OUTSIDE_INDEF;
+		return ret;
 	}
 
-	uint8_t ib_mt = buf[*pos] & 0xe0;
-	uint8_t ib_ai = buf[*pos] & 0x1f;
-	if (ib_ai < 28)
+	if (ib_ai != AI_INDEF)
 	{
-		size_t len = (ib_ai == AI_1) ? 1 \
-			: (ib_ai == AI_2) ? 2 \
-			: (ib_ai == AI_4) ? 4 \
-			: (ib_ai == AI_8) ? 8 \
-			: 0;
-		if (!ensure_capacity(buf, size, *pos + len + 1))
-		{
-			return CBOR_ERR_OUT_OF_DATA;
-		}
-		
-		++*pos;
-		uint64_t val = (len == 1) ? buf[*pos] \
-			: (len == 2) ? nbtos(buf + *pos) \
-			: (len == 4) ? nbtol(buf + *pos) \
-			: (len == 8) ? nbtoll(buf + *pos) \
-			: ib_ai;
-		*pos += len;
-
 		if (ib_mt == IB_UINT)
 		{
 			cbor->ct = CBOR_UINT;
@@ -69,9 +82,9 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 			cbor->ct = CBOR_NEGINT;
 			cbor->v.sint = (int64_t)~val;
 		}
-		if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
 		{
-			if (!ensure_capacity(buf, size, *pos + val))
+			if (val > size - *pos)
 			{
 				return CBOR_ERR_OUT_OF_DATA;
 			}
@@ -92,7 +105,7 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 			size_t _pos = *pos;
 			for (uint64_t i = 0; i < val; i++)
 			{
-				int ret = cbor_verify(buf, size, pos);
+				ret = cbor_verify(buf, size, pos);
 				if (ret != CBOR_NO_ERROR)
 				{
 					return ret;
@@ -103,6 +116,7 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 			cbor->v.bytes = buf + _pos;
 			cbor->count = val;
 			cbor->size = *pos - _pos;
+			cbor->index = NULL;
 		}
 		else if (ib_mt == IB_TAG)
 		{
@@ -111,17 +125,17 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 
 			if (cbor->next == NULL)
 			{
-				cbor->next = cbor_create();
+				cbor->next = cbor_create_with(allocator);
 				if (cbor->next == NULL)
 				{
 					return CBOR_ERR_OUT_OF_MEMORY;
 				}
 			}
 			
-			int ret = cbor_decode_tag(buf, size, pos, val, cbor->next);
+			ret = __cbor_decode_tag(buf, size, pos, val, cbor->next, allocator);
 			if (ret != CBOR_NO_ERROR)
 			{
-				cbor_free(cbor->next);
+				cbor_free_with(cbor->next, allocator);
 				cbor->next = NULL;
 			}
 			return ret;
@@ -147,19 +161,18 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 			else if (ib_ai == AI_2)
 			{
 				cbor->ct = CBOR_FLOAT;
-				uint16_t s = (uint16_t)val;
-				cbor->v.flt = htof(*((half *)&s));
+				cbor->v.flt = htof((half)val);
 			}
 			else if (ib_ai == AI_4)
 			{
 				cbor->ct = CBOR_FLOAT;
 				uint32_t l = (uint32_t)val;
-				cbor->v.flt = *((float *)&l);
+				memcpy(&cbor->v.flt, &l, sizeof(cbor->v.flt));
 			}
 			else if (ib_ai == AI_8)
 			{
 				cbor->ct = CBOR_DOUBLE;
-				cbor->v.dbl = *((double *)&val);
+				memcpy(&cbor->v.dbl, &val, sizeof(cbor->v.dbl));
 			}
 			else
 			{
@@ -169,34 +182,30 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 		}
 		return CBOR_NO_ERROR;
 	}
-	else if (ib_ai < AI_INDEF)
-	{
-		return CBOR_ERR_RESERVED_AI;
-	}
 	else // if (ib_ai == AI_INDEF)
 	{
-		if (ib_mt != IB_BYTES && ib_mt != IB_STRING && ib_mt != IB_ARRAY && ib_mt != IB_MAP)
-		{
-			return CBOR_ERR_MT_UNDEF_FOR_INDEF;
-		}
-
-		if (!ensure_capacity(buf, size, *pos + 2))
-		{
-			return CBOR_ERR_OUT_OF_DATA;
-		}
-
-		size_t _pos = ++*pos;
+		size_t _pos = *pos;
 		size_t count = 0;
 		if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
 		{
-			while (buf[*pos] != AI_BRKCD)
+			for (;;)
 			{
+				if (!ensure_capacity(buf, size, *pos + 1))
+				{
+					return CBOR_ERR_OUT_OF_DATA;
+				}
+
+				if (buf[*pos] == AI_BRKCD)
+				{
+					break;
+				}
+
 				if ((buf[*pos] & 0xe0) != ib_mt /*|| (buf[*pos] & 0x1f) == AI_INDEF*/)
 				{
 					return CBOR_ERR_BYTES_TEXT_MISMATCH;
 				}
 
-				int ret = cbor_verify(buf, size, pos);
+				ret = cbor_verify(buf, size, pos);
 				if (ret != CBOR_NO_ERROR)
 				{
 					return ret;
@@ -209,9 +218,19 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 		}
 		else // if (ib_mt == IB_ARRAY || ib_mt == IB_MAP)
 		{
-			while (buf[*pos] != AI_BRKCD)
+			for (;;)
 			{
-				int ret = cbor_verify(buf, size, pos);
+				if (!ensure_capacity(buf, size, *pos + 1))
+				{
+					return CBOR_ERR_OUT_OF_DATA;
+				}
+
+				if (buf[*pos] == AI_BRKCD)
+				{
+					break;
+				}
+
+				ret = cbor_verify(buf, size, pos);
 				if (ret != CBOR_NO_ERROR)
 				{
 					return ret;
@@ -226,6 +245,7 @@ int cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor)
 			}
 
 			cbor->ct = ib_mt == IB_ARRAY ? CBOR_ARRAY : CBOR_MAP;
+			cbor->index = NULL;
 		}
 		cbor->v.bytes = buf + _pos;
 		cbor->count = count;
@@ -23,9 +23,19 @@
 ****************************************************************************/
 
 #include "cbor.h"
+#include "cbor_header.h"
 
 int cbor_decode_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag, cbor_t *cbor)
 {
-	(void) tag;
-	return cbor_decode(buf, size, pos, cbor);
+	return __cbor_decode_tag(buf, size, pos, tag, cbor, cbor_get_allocator());
+}
+
+int __cbor_decode_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag, cbor_t *cbor, const cbor_allocator_t *allocator)
+{
+	int ret = __cbor_typed_array_check(buf, size, *pos, tag);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return __cbor_decode(buf, size, pos, cbor, allocator);
 }
@@ -0,0 +1,947 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+#include "endian.h"
+#include "fp16.h"
+#include <stdlib.h>
+#include <string.h>
+
+// maps with more entries than this are sorted with qsort()
+#define INSERTION_SORT_MAX			16
+
+/** Key and value of a map being sorted, in place in the output buffer */
+typedef struct
+{
+	const uint8_t *key;
+	size_t key_len;
+	/** Bytes of the key and the value */
+	size_t len;
+	/** First eight bytes of the key in network order, zero padded */
+	uint64_t prefix;
+} __cbor_entry_t;
+
+/** Container of a cbor_encode_deterministic() description whose children are still being encoded */
+typedef struct
+{
+	uint64_t count;
+	uint64_t left;
+	/** Index of the first entry of a map */
+	size_t entries;
+	bool is_map;
+} __cbor_frame_t;
+
+/** Container being checked by cbor_verify_canonical() */
+typedef struct
+{
+	uint8_t ib_mt;
+	uint64_t remaining;
+	uint64_t count;
+	/** Start of the current key of a map */
+	size_t key;
+	/** Previous key of a map, prev_len is 0 before the first one */
+	size_t prev;
+	size_t prev_len;
+} __cbor_canon_frame_t;
+
+/** Container being rewritten by cbor_canonicalize() */
+typedef struct
+{
+	uint8_t ib_mt;
+	bool indef;
+	uint64_t remaining;
+	uint64_t count;
+	/** Index of the first entry of a map */
+	size_t entries;
+} __cbor_norm_frame_t;
+
+/** Growable list of the entries of the maps being rewritten */
+typedef struct
+{
+	__cbor_entry_t *buf;
+	size_t cap;
+	size_t used;
+	const cbor_allocator_t *allocator;
+} __cbor_entry_list_t;
+
+/** Item counts, or chunk payload bytes, of the indefinite-length items being rewritten in document order */
+typedef struct
+{
+	uint64_t *buf;
+	size_t cap;
+	size_t used;
+	/** Index of the count of the next indefinite-length header the rewrite meets */
+	size_t next;
+	const cbor_allocator_t *allocator;
+} __cbor_count_list_t;
+
+/** Container, tag or indefinite-length string being counted ahead of the rewrite */
+typedef struct
+{
+	uint8_t ib_mt;
+	bool indef;
+	uint64_t remaining;
+	/** Index of the count of an indefinite-length item */
+	size_t slot;
+} __cbor_count_frame_t;
+
+/** Buffer the entries of a map are moved through, grown to the largest map */
+typedef struct
+{
+	uint8_t *buf;
+	size_t size;
+	const cbor_allocator_t *allocator;
+} __cbor_scratch_t;
+
+static uint64_t __cbor_key_prefix(const uint8_t *key, size_t len)
+{
+	if (len >= 8)
+	{
+		return nbtoll(key);
+	}
+
+	uint64_t prefix = 0;
+	for (size_t i = 0; i < 8; i++)
+	{
+		prefix = (prefix << 8) | (i < len ? key[i] : 0);
+	}
+	return prefix;
+}
+
+// bytewise lexicographic order of the encoded keys, RFC 8949 4.2.1
+static int __cbor_entry_compare(const __cbor_entry_t *a, const __cbor_entry_t *b)
+{
+	if (a->prefix != b->prefix)
+	{
+		return a->prefix < b->prefix ? -1 : 1;
+	}
+
+	size_t len = a->key_len < b->key_len ? a->key_len : b->key_len;
+	if (len > 8)
+	{
+		int res = memcmp(a->key + 8, b->key + 8, len - 8);
+		if (res != 0)
+		{
+			return res;
+		}
+	}
+	return (a->key_len > b->key_len) - (a->key_len < b->key_len);
+}
+
+static int __cbor_entry_qsort(const void *a, const void *b)
+{
+	return __cbor_entry_compare((const __cbor_entry_t *)a, (const __cbor_entry_t *)b);
+}
+
+static int __cbor_scratch_reserve(__cbor_scratch_t *scratch, size_t size)
+{
+	if (size <= scratch->size)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	// the old contents are not needed
+	if (scratch->buf != NULL)
+	{
+		scratch->allocator->free(scratch->allocator->ctx, scratch->buf, scratch->size);
+	}
+
+	scratch->size = 0;
+	scratch->buf = (uint8_t *)scratch->allocator->alloc(scratch->allocator->ctx, size);
+	if (scratch->buf == NULL)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	scratch->size = size;
+	return CBOR_NO_ERROR;
+}
+
+// puts the k entries of a map laid out back to back from buf + first in key order, in the common case
+// of keys already in order nothing is moved
+static int __cbor_sort_entries(uint8_t *buf, size_t first, __cbor_entry_t *entries, size_t k, __cbor_scratch_t *scratch)
+{
+	size_t total = 0;
+	bool sorted = true;
+	for (size_t i = 0; i < k; i++)
+	{
+		entries[i].prefix = __cbor_key_prefix(entries[i].key, entries[i].key_len);
+		total += entries[i].len;
+
+		if (i > 0 && sorted)
+		{
+			int res = __cbor_entry_compare(&entries[i - 1], &entries[i]);
+			if (res == 0)
+			{
+				return CBOR_ERR_DUPLICATE_KEY;
+			}
+			sorted = res < 0;
+		}
+	}
+
+	if (sorted)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	if (k > INSERTION_SORT_MAX)
+	{
+		qsort(entries, k, sizeof(__cbor_entry_t), __cbor_entry_qsort);
+	}
+	else
+	{
+		for (size_t i = 1; i < k; i++)
+		{
+			__cbor_entry_t entry = entries[i];
+			size_t j = i;
+			for (; j > 0 && __cbor_entry_compare(&entries[j - 1], &entry) > 0; j--)
+			{
+				entries[j] = entries[j - 1];
+			}
+			entries[j] = entry;
+		}
+	}
+
+	for (size_t i = 1; i < k; i++)
+	{
+		if (__cbor_entry_compare(&entries[i - 1], &entries[i]) == 0)
+		{
+			return CBOR_ERR_DUPLICATE_KEY;
+		}
+	}
+
+	int ret = __cbor_scratch_reserve(scratch, total);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	memcpy(scratch->buf, buf + first, total);
+	for (size_t i = 0, out = first; i < k; i++)
+	{
+		memcpy(buf + out, scratch->buf + (entries[i].key - (buf + first)), entries[i].len);
+		out += entries[i].len;
+	}
+	return CBOR_NO_ERROR;
+}
+
+// sorts the map of the innermost frame once all of its children are encoded and pops it, repeatedly
+static int __cbor_close_frames(uint8_t *buf, size_t pos, __cbor_frame_t *frames, size_t *depth, __cbor_entry_t *entries, size_t *used, __cbor_scratch_t *scratch)
+{
+	while (*depth > 0 && frames[*depth - 1].left == 0)
+	{
+		__cbor_frame_t *frame = &frames[--*depth];
+		if (frame->is_map)
+		{
+			__cbor_entry_t *first = &entries[frame->entries];
+			size_t k = *used - frame->entries;
+			for (size_t i = 0; i < k; i++)
+			{
+				const uint8_t *end = i + 1 < k ? first[i + 1].key : buf + pos;
+				first[i].len = end - first[i].key;
+			}
+
+			int ret = __cbor_sort_entries(buf, first->key - buf, first, k, scratch);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+			*used = frame->entries;
+		}
+	}
+	return CBOR_NO_ERROR;
+}
+
+static int __cbor_encode_deterministic(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n, __cbor_frame_t *frames, __cbor_entry_t *entries, __cbor_scratch_t *scratch)
+{
+	size_t depth = 0, used = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (depth > 0)
+		{
+			__cbor_frame_t *frame = &frames[depth - 1];
+			if (frame->is_map && (frame->count - frame->left) % 2 == 0)
+			{
+				entries[used].key = buf + *pos;
+				entries[used++].key_len = 0;
+			}
+			else if (frame->is_map)
+			{
+				// the key and all of its children are done
+				entries[used - 1].key_len = buf + *pos - entries[used - 1].key;
+			}
+			frame->left--;
+		}
+
+		int ret = __cbor_encode_item(buf, size, pos, &items[i]);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		uint64_t children = items[i].ct == CBOR_TAG ? 1 \
+			: (items[i].ct == CBOR_ARRAY || items[i].ct == CBOR_MAP) ? items[i].count \
+			: 0;
+		if (children > 0)
+		{
+			frames[depth].count = children;
+			frames[depth].left = children;
+			frames[depth].entries = used;
+			frames[depth++].is_map = items[i].ct == CBOR_MAP;
+			continue;
+		}
+
+		ret = __cbor_close_frames(buf, *pos, frames, &depth, entries, &used, scratch);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+	return CBOR_NO_ERROR;
+}
+
+// 23. encode items in deterministic encoding
+int cbor_encode_deterministic(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n)
+{
+	return cbor_encode_deterministic_with(buf, size, pos, items, n, NULL);
+}
+
+int cbor_encode_deterministic_with(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n, const cbor_allocator_t *allocator)
+{
+	allocator = allocator != NULL ? allocator : cbor_get_allocator();
+
+	size_t len;
+	int ret = cbor_encoded_size_items(items, n, &len);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (len > size - *pos)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	// headers are already the shortest, only indefinite lengths and key order are left
+	size_t containers = 0, keys = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (items[i].ct == CBOR_BYTES_INDEF || items[i].ct == CBOR_STRING_INDEF)
+		{
+			return CBOR_ERR_NOT_DETERMINISTIC;
+		}
+		else if (items[i].ct == CBOR_TAG || ((items[i].ct == CBOR_ARRAY || items[i].ct == CBOR_MAP) && items[i].count > 0))
+		{
+			containers++;
+			keys += items[i].ct == CBOR_MAP ? items[i].count >> 1 : 0;
+		}
+	}
+
+	__cbor_frame_t *frames = NULL;
+	__cbor_entry_t *entries = NULL;
+	__cbor_scratch_t scratch = { NULL, 0, allocator };
+	if (containers > 0)
+	{
+		frames = (__cbor_frame_t *)allocator->alloc(allocator->ctx, containers * sizeof(__cbor_frame_t));
+		entries = keys > 0 ? (__cbor_entry_t *)allocator->alloc(allocator->ctx, keys * sizeof(__cbor_entry_t)) : NULL;
+		if (frames == NULL || (keys > 0 && entries == NULL))
+		{
+			ret = CBOR_ERR_OUT_OF_MEMORY;
+		}
+	}
+
+	size_t _pos = *pos;
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = __cbor_encode_deterministic(buf, size, pos, items, n, frames, entries, &scratch);
+	}
+
+	if (ret != CBOR_NO_ERROR)
+	{
+		*pos = _pos;
+	}
+
+	if (scratch.buf != NULL)
+	{
+		allocator->free(allocator->ctx, scratch.buf, scratch.size);
+	}
+
+	if (entries != NULL)
+	{
+		allocator->free(allocator->ctx, entries, keys * sizeof(__cbor_entry_t));
+	}
+
+	if (frames != NULL)
+	{
+		allocator->free(allocator->ctx, frames, containers * sizeof(__cbor_frame_t));
+	}
+	return ret;
+}
+
+// value of a float header, the payload is in val as read by __cbor_read_header()
+static double __cbor_float_value(uint8_t ib_ai, uint64_t val)
+{
+	if (ib_ai == AI_2)
+	{
+		return htof((half)val);
+	}
+	else if (ib_ai == AI_4)
+	{
+		float flt;
+		uint32_t l = (uint32_t)val;
+		memcpy(&flt, &l, sizeof(flt));
+		return flt;
+	}
+
+	double dbl;
+	memcpy(&dbl, &val, sizeof(dbl));
+	return dbl;
+}
+
+// smallest argument of each of the one, two, four and eight byte forms
+static const uint64_t __cbor_min_arg[] = { 24, 0x100, 0x10000, 0x100000000 };
+
+// the header is the one the encoder writes for the same value, floats are held to the choice of cbor_encode_float()
+static inline int __cbor_check_header(uint8_t ib_mt, uint8_t ib_ai, uint64_t val)
+{
+	if (ib_ai < AI_1)
+	{
+		return CBOR_NO_ERROR;
+	}
+	else if (ib_mt != IB_PRIM || ib_ai == AI_1)
+	{
+		if (ib_mt == IB_PRIM && val > 23 && val < 32)
+		{
+			return CBOR_ERR_SIMPLE_OUT_OF_SCOPE;
+		}
+		return ib_ai <= AI_8 && val >= __cbor_min_arg[ib_ai - AI_1] ? CBOR_NO_ERROR : CBOR_ERR_NOT_DETERMINISTIC;
+	}
+
+	bool shortest;
+	if (ib_ai == AI_2)
+	{
+		// the only NaN is 0x7e00
+		shortest = (val & 0x7c00) != 0x7c00 || (val & 0x03ff) == 0 || val == 0x7e00;
+	}
+	else if (ib_ai == AI_4)
+	{
+		float flt;
+		uint32_t l = (uint32_t)val;
+		memcpy(&flt, &l, sizeof(flt));
+		shortest = is_ftoh_loss(flt);
+	}
+	else
+	{
+		double dbl;
+		memcpy(&dbl, &val, sizeof(dbl));
+		shortest = dbl == dbl && (double)(float)dbl != dbl;
+	}
+	return shortest ? CBOR_NO_ERROR : CBOR_ERR_NOT_DETERMINISTIC;
+}
+
+// orders a key after the previous one of its map
+static int __cbor_check_key(const uint8_t *buf, __cbor_canon_frame_t *frame, size_t end)
+{
+	size_t len = end - frame->key;
+	if (frame->prev_len > 0)
+	{
+		size_t min = len < frame->prev_len ? len : frame->prev_len;
+		int res = memcmp(buf + frame->prev, buf + frame->key, min);
+		if (res == 0)
+		{
+			res = (frame->prev_len > len) - (frame->prev_len < len);
+		}
+
+		if (res >= 0)
+		{
+			return res == 0 ? CBOR_ERR_DUPLICATE_KEY : CBOR_ERR_NOT_DETERMINISTIC;
+		}
+	}
+
+	frame->prev = frame->key;
+	frame->prev_len = len;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_verify_canonical(const uint8_t *buf, size_t size, size_t *pos)
+{
+	__cbor_canon_frame_t stack[CBOR_MAX_DEPTH];
+	size_t depth = 0;
+
+	// the current level lives in locals like in cbor_verify_depth()
+	__cbor_canon_frame_t frame;
+	frame.ib_mt = IB_ARRAY;
+	frame.remaining = 1;
+	frame.count = 0;
+	frame.prev_len = 0;
+
+	for (;;)
+	{
+		if (frame.remaining == 0)
+		{
+			if (depth == 0)
+			{
+				return CBOR_NO_ERROR;
+			}
+
+			frame = stack[--depth];
+			continue;
+		}
+
+		if (frame.ib_mt == IB_MAP)
+		{
+			// keys are compared once they are complete, when their value starts
+			if (frame.count % 2 == 0)
+			{
+				frame.key = *pos;
+			}
+			else
+			{
+				int ret = __cbor_check_key(buf, &frame, *pos);
+				if (ret != CBOR_NO_ERROR)
+				{
+					*pos = frame.key;
+					return ret;
+				}
+			}
+		}
+		else if (*pos < size && __cbor_is_immediate(buf[*pos]))
+		{
+			// one-byte items are always in their shortest form, skip runs of them outside of maps
+			size_t len = 1;
+			if (frame.remaining > 1 && *pos + 1 < size && __cbor_is_immediate(buf[*pos + 1]))
+			{
+				len = __cbor_scan_immediates(buf + *pos, size - *pos);
+				if (len > frame.remaining)
+				{
+					len = (size_t)frame.remaining;
+				}
+			}
+
+			*pos += len;
+			frame.count += len;
+			frame.remaining -= len;
+			continue;
+		}
+
+		size_t _pos = *pos;
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		int ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret == CBOR_NO_ERROR)
+		{
+			ret = __cbor_check_header(ib_mt, ib_ai, val);
+		}
+
+		if (ret != CBOR_NO_ERROR)
+		{
+			*pos = _pos;
+			return ret;
+		}
+
+		frame.count++;
+		frame.remaining--;
+
+		if (ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
+		{
+			if (ib_mt == IB_MAP && val % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			if (depth >= CBOR_MAX_DEPTH)
+			{
+				*pos = _pos;
+				return CBOR_ERR_DEPTH_EXCEEDED;
+			}
+
+			stack[depth++] = frame;
+			frame.ib_mt = ib_mt;
+			frame.remaining = ib_mt == IB_TAG ? 1 : val;
+			frame.count = 0;
+			frame.prev_len = 0;
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			if (val > size - *pos)
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			*pos += val;
+		}
+	}
+}
+
+static int __cbor_entry_push(__cbor_entry_list_t *list, const uint8_t *key)
+{
+	if (list->used == list->cap)
+	{
+		size_t cap = list->cap > 0 ? list->cap << 1 : 64;
+		__cbor_entry_t *buf = (__cbor_entry_t *)list->allocator->alloc(list->allocator->ctx, cap * sizeof(__cbor_entry_t));
+		if (buf == NULL)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		if (list->buf != NULL)
+		{
+			memcpy(buf, list->buf, list->used * sizeof(__cbor_entry_t));
+			list->allocator->free(list->allocator->ctx, list->buf, list->cap * sizeof(__cbor_entry_t));
+		}
+		list->buf = buf;
+		list->cap = cap;
+	}
+
+	list->buf[list->used].key = key;
+	list->buf[list->used++].key_len = 0;
+	return CBOR_NO_ERROR;
+}
+
+static int __cbor_count_push(__cbor_count_list_t *counts)
+{
+	if (counts->used == counts->cap)
+	{
+		size_t cap = counts->cap > 0 ? counts->cap << 1 : 64;
+		uint64_t *buf = (uint64_t *)counts->allocator->alloc(counts->allocator->ctx, cap * sizeof(uint64_t));
+		if (buf == NULL)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		if (counts->buf != NULL)
+		{
+			memcpy(buf, counts->buf, counts->used * sizeof(uint64_t));
+			counts->allocator->free(counts->allocator->ctx, counts->buf, counts->cap * sizeof(uint64_t));
+		}
+		counts->buf = buf;
+		counts->cap = cap;
+	}
+
+	counts->buf[counts->used++] = 0;
+	return CBOR_NO_ERROR;
+}
+
+// one pass over a well-formed item counting the items, or chunk payload bytes, of each indefinite-length
+// item, so the rewrite can write definite headers without scanning ahead at every level
+static int __cbor_indef_counts(const uint8_t *buf, size_t size, size_t pos, __cbor_count_list_t *counts)
+{
+	// indefinite-length strings take a frame on top of CBOR_MAX_DEPTH containers
+	__cbor_count_frame_t stack[CBOR_MAX_DEPTH + 1];
+	size_t depth = 0;
+
+	__cbor_count_frame_t frame;
+	frame.ib_mt = IB_ARRAY;
+	frame.indef = false;
+	frame.remaining = 1;
+	frame.slot = 0;
+
+	for (;;)
+	{
+		if ((!frame.indef && frame.remaining == 0) || (frame.indef && buf[pos] == AI_BRKCD))
+		{
+			if (depth == 0)
+			{
+				return CBOR_NO_ERROR;
+			}
+
+			pos += frame.indef;
+			frame = stack[--depth];
+			continue;
+		}
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		int ret = __cbor_read_header(buf, size, &pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		frame.remaining -= !frame.indef;
+		bool chunk = frame.indef && (frame.ib_mt == IB_BYTES || frame.ib_mt == IB_STRING);
+		if (chunk && ib_ai == AI_INDEF)
+		{
+			return CBOR_ERR_MT_UNDEF_FOR_INDEF;
+		}
+		else if (frame.indef)
+		{
+			counts->buf[frame.slot] += chunk ? val : 1;
+		}
+
+		if (ib_ai == AI_INDEF || ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
+		{
+			if (depth >= CBOR_MAX_DEPTH && (ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG))
+			{
+				return CBOR_ERR_DEPTH_EXCEEDED;
+			}
+
+			size_t slot = counts->used;
+			if (ib_ai == AI_INDEF)
+			{
+				ret = __cbor_count_push(counts);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+			}
+
+			stack[depth++] = frame;
+			frame.ib_mt = ib_mt;
+			frame.indef = ib_ai == AI_INDEF;
+			frame.remaining = ib_mt == IB_TAG ? 1 : val;
+			frame.slot = slot;
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			pos += val;
+		}
+	}
+}
+
+// sorts the map of the innermost frame once all of its children are written
+static int __cbor_norm_close(uint8_t *out, size_t out_pos, const __cbor_norm_frame_t *frame, __cbor_entry_list_t *list, __cbor_scratch_t *scratch)
+{
+	if (frame->ib_mt != IB_MAP)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	__cbor_entry_t *first = &list->buf[frame->entries];
+	size_t k = list->used - frame->entries;
+	for (size_t i = 0; i < k; i++)
+	{
+		const uint8_t *end = i + 1 < k ? first[i + 1].key : out + out_pos;
+		first[i].len = end - first[i].key;
+	}
+
+	list->used = frame->entries;
+	return k > 0 ? __cbor_sort_entries(out, first->key - out, first, k, scratch) : CBOR_NO_ERROR;
+}
+
+// rewrites a well-formed item, indefinite lengths are taken from the counts of __cbor_indef_counts()
+static int __cbor_canonicalize(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out, size_t out_size, size_t *out_pos, __cbor_entry_list_t *list, __cbor_count_list_t *counts, __cbor_scratch_t *scratch)
+{
+	__cbor_norm_frame_t stack[CBOR_MAX_DEPTH];
+	size_t depth = 0;
+
+	__cbor_norm_frame_t frame;
+	frame.ib_mt = IB_ARRAY;
+	frame.indef = false;
+	frame.remaining = 1;
+	frame.count = 0;
+
+	for (;;)
+	{
+		if ((!frame.indef && frame.remaining == 0) || (frame.indef && buf[*pos] == AI_BRKCD))
+		{
+			if (depth == 0)
+			{
+				return CBOR_NO_ERROR;
+			}
+
+			*pos += frame.indef;
+			int ret = __cbor_norm_close(out, *out_pos, &frame, list, scratch);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			frame = stack[--depth];
+			continue;
+		}
+
+		if (frame.ib_mt == IB_MAP && frame.count % 2 == 0)
+		{
+			int ret = __cbor_entry_push(list, out + *out_pos);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+		else if (frame.ib_mt == IB_MAP)
+		{
+			__cbor_entry_t *entry = &list->buf[list->used - 1];
+			entry->key_len = out + *out_pos - entry->key;
+		}
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		int ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		frame.count++;
+		frame.remaining -= !frame.indef;
+
+		if (ib_mt == IB_PRIM && (ib_ai == AI_2 || ib_ai == AI_4 || ib_ai == AI_8))
+		{
+			ret = cbor_encode_float(out, out_size, out_pos, __cbor_float_value(ib_ai, val));
+		}
+		else if (ib_mt == IB_PRIM)
+		{
+			ret = cbor_encode_simple(out, out_size, out_pos, (uint8_t)val);
+		}
+		else if ((ib_mt == IB_BYTES || ib_mt == IB_STRING) && ib_ai == AI_INDEF)
+		{
+			// chunks are joined into one string
+			uint64_t len = counts->buf[counts->next++];
+			ret = cbor_encode_header(out, out_size, out_pos, ib_mt, len);
+
+			if (ret == CBOR_NO_ERROR && len > out_size - *out_pos)
+			{
+				ret = CBOR_ERR_OUT_OF_MEMORY;
+			}
+
+			for (; ret == CBOR_NO_ERROR && buf[*pos] != AI_BRKCD; *pos += val, *out_pos += val)
+			{
+				uint8_t chunk_mt, chunk_ai;
+				__cbor_read_header(buf, size, pos, &chunk_mt, &chunk_ai, &val);
+				memcpy(out + *out_pos, buf + *pos, (size_t)val);
+			}
+			++*pos;
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			ret = cbor_encode_header(out, out_size, out_pos, ib_mt, val);
+			if (ret == CBOR_NO_ERROR && val > out_size - *out_pos)
+			{
+				ret = CBOR_ERR_OUT_OF_MEMORY;
+			}
+
+			if (ret == CBOR_NO_ERROR)
+			{
+				memcpy(out + *out_pos, buf + *pos, (size_t)val);
+				*pos += val;
+				*out_pos += val;
+			}
+		}
+		else if (ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
+		{
+			if (ib_ai == AI_INDEF)
+			{
+				val = counts->buf[counts->next++];
+			}
+
+			ret = cbor_encode_header(out, out_size, out_pos, ib_mt, val);
+
+			if (ret == CBOR_NO_ERROR)
+			{
+				if (depth >= CBOR_MAX_DEPTH)
+				{
+					return CBOR_ERR_DEPTH_EXCEEDED;
+				}
+
+				stack[depth++] = frame;
+				frame.ib_mt = ib_mt;
+				frame.indef = ib_ai == AI_INDEF;
+				frame.remaining = ib_mt == IB_TAG ? 1 : val;
+				frame.count = 0;
+				frame.entries = list->used;
+			}
+		}
+		else
+		{
+			ret = cbor_encode_header(out, out_size, out_pos, ib_mt, val);
+		}
+
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+}
+
+int cbor_canonicalize(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out, size_t out_size, size_t *out_pos)
+{
+	return cbor_canonicalize_with(buf, size, pos, out, out_size, out_pos, NULL);
+}
+
+int cbor_canonicalize_with(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out, size_t out_size, size_t *out_pos, const cbor_allocator_t *allocator)
+{
+	allocator = allocator != NULL ? allocator : cbor_get_allocator();
+
+	// most input already is canonical and is copied as is
+	size_t end = *pos;
+	int ret = cbor_verify_canonical(buf, size, &end);
+	if (ret == CBOR_NO_ERROR)
+	{
+		if (end - *pos > out_size - *out_pos)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		memcpy(out + *out_pos, buf + *pos, end - *pos);
+		*out_pos += end - *pos;
+		*pos = end;
+		return CBOR_NO_ERROR;
+	}
+	else if (ret != CBOR_ERR_NOT_DETERMINISTIC)
+	{
+		return ret;
+	}
+
+	// the rewrite trusts the structure
+	end = *pos;
+	ret = cbor_verify(buf, size, &end);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	__cbor_entry_list_t list = { NULL, 0, 0, allocator };
+	__cbor_count_list_t counts = { NULL, 0, 0, 0, allocator };
+	__cbor_scratch_t scratch = { NULL, 0, allocator };
+	size_t _pos = *pos, _out_pos = *out_pos;
+	ret = __cbor_indef_counts(buf, size, *pos, &counts);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = __cbor_canonicalize(buf, size, pos, out, out_size, out_pos, &list, &counts, &scratch);
+	}
+
+	if (ret != CBOR_NO_ERROR)
+	{
+		*pos = _pos;
+		*out_pos = _out_pos;
+	}
+
+	if (counts.buf != NULL)
+	{
+		allocator->free(allocator->ctx, counts.buf, counts.cap * sizeof(uint64_t));
+	}
+
+	if (scratch.buf != NULL)
+	{
+		allocator->free(allocator->ctx, scratch.buf, scratch.size);
+	}
+
+	if (list.buf != NULL)
+	{
+		allocator->free(allocator->ctx, list.buf, list.cap * sizeof(__cbor_entry_t));
+	}
+	return ret;
+}
@@ -34,13 +34,47 @@ bool ensure_capacity(const uint8_t *buf, size_t size, size_t offset)
 	return size >= offset;
 }
 
-static int __cbor_encode_uint(uint8_t *buf, size_t size, size_t *pos, uint8_t ib_mt, uint64_t val)
+// argument bytes following the initial byte
+static inline size_t __cbor_uint_len(uint64_t val)
 {
-	size_t len = (val <= 23) ? 0 \
+	return (val <= 23) ? 0 \
 		: (val <= 255) ? 1 \
 		: (val <= 65535) ? 2 \
 		: (val <= 4294967295) ? 4 \
 		: 8;
+}
+
+// payload bytes of the shortest of half, float and double holding val, as chosen by cbor_encode_float()
+static inline size_t __cbor_float_len(double val)
+{
+	if (val == 0.0 || !isfinite(val))				// 0.0, -0.0, NaN, Infinity
+	{
+		return 2;
+	}
+
+	float fval = (float)val;
+	return (fval != val) ? 8 \
+		: is_ftoh_loss(fval) ? 4 \
+		: 2;
+}
+
+// 0..4 for arguments held in the initial byte, 1, 2, 4 and 8 bytes, without branches
+static inline size_t __cbor_uint_code(uint64_t val)
+{
+	return (val > 23) + (val > 255) + (val > 65535) + (val > 4294967295);
+}
+
+static const uint8_t __cbor_code_len[] = { 0, 1, 2, 4, 8 };
+
+// stores the len low bytes of val in network order, writing 8 bytes at p regardless
+static inline void __cbor_store_uint(uint8_t *p, uint64_t val, size_t len)
+{
+	lltonb(len > 0 ? val << ((8 - len) << 3) : 0, p);
+}
+
+static int __cbor_encode_uint(uint8_t *buf, size_t size, size_t *pos, uint8_t ib_mt, uint64_t val)
+{
+	size_t len = __cbor_uint_len(val);
 	if (!ensure_capacity(buf, size, *pos + len + 1))
 	{
 		return CBOR_ERR_OUT_OF_MEMORY;
@@ -87,6 +121,7 @@ static int __cbor_encode_bytes(uint8_t *buf, size_t size, size_t *pos, uint8_t i
 	{
 		memcpy(buf + *pos, bytes, len);
 		*pos += len;
+		return CBOR_NO_ERROR;
 	}
 	return CBOR_ERR_OUT_OF_MEMORY;
 }
@@ -142,7 +177,7 @@ int cbor_encode_float(uint8_t *buf, size_t size, size_t *pos, double val)
 	if (val == 0.0)									// 0.0, -0.0
 	{
 		buf[(*pos)++] = IB_PRIM | AI_2;
-		stonb((*((uint64_t *)&val) & 0x8000000000000000) ? 0x8000 : 0x0000, buf + *pos);
+		stonb(signbit(val) ? 0x8000 : 0x0000, buf + *pos);
 		*pos += 2;
 	}
 	else if (isnan(val))							// NaN
@@ -154,7 +189,7 @@ int cbor_encode_float(uint8_t *buf, size_t size, size_t *pos, double val)
 	else if (!isfinite(val))						// Infinity
 	{
 		buf[(*pos)++] = IB_PRIM | AI_2;
-		stonb((*((uint64_t *)&val) & 0x8000000000000000) ? 0xfc00 : 0x7c00, buf + *pos);
+		stonb(signbit(val) ? 0xfc00 : 0x7c00, buf + *pos);
 		*pos += 2;
 	}
 	else
@@ -251,3 +286,390 @@ int cbor_encode_break(uint8_t *buf, size_t size, size_t *pos)
 	}
 	return CBOR_ERR_OUT_OF_MEMORY;
 }
+
+// 15. encode initial byte and argument
+int cbor_encode_header(uint8_t *buf, size_t size, size_t *pos, uint8_t ib_mt, uint64_t val)
+{
+	return __cbor_encode_uint(buf, size, pos, ib_mt, val);
+}
+
+// 16. encoded sizes, matching the functions above
+size_t cbor_encoded_size_header(uint64_t val)
+{
+	return 1 + __cbor_uint_len(val);
+}
+
+size_t cbor_encoded_size_int(int64_t val)
+{
+	return 1 + __cbor_uint_len((val & 0x8000000000000000) ? ~val : val);
+}
+
+size_t cbor_encoded_size_uint(uint64_t val)
+{
+	return 1 + __cbor_uint_len(val);
+}
+
+size_t cbor_encoded_size_simple(uint8_t val)
+{
+	return 1 + __cbor_uint_len(val);
+}
+
+size_t cbor_encoded_size_float(double val)
+{
+	return 1 + __cbor_float_len(val);
+}
+
+size_t cbor_encoded_size_bytes(size_t len)
+{
+	return 1 + __cbor_uint_len(len) + len;
+}
+
+size_t cbor_encoded_size_string(const char *str)
+{
+	return cbor_encoded_size_bytes(strlen(str));
+}
+
+size_t cbor_encoded_size_array(size_t len)
+{
+	return 1 + __cbor_uint_len(len);
+}
+
+size_t cbor_encoded_size_map(size_t len)
+{
+	return 1 + __cbor_uint_len(len << 1);
+}
+
+// encoded size of one described item, and the number of items describing its content
+static int __cbor_item_size(const cbor_t *item, size_t *size, size_t *children)
+{
+	*children = 0;
+	if (item->ct == CBOR_FALSE || item->ct == CBOR_TRUE || item->ct == CBOR_NULL || item->ct == CBOR_UNDEFINED)
+	{
+		*size = 1;
+	}
+	else if (item->ct == CBOR_UINT || item->ct == CBOR_TAG)
+	{
+		*size = 1 + __cbor_uint_len(item->v.uint);
+		*children = item->ct == CBOR_TAG ? 1 : 0;
+	}
+	else if (item->ct == CBOR_NEGINT)
+	{
+		*size = cbor_encoded_size_int(item->v.sint);
+	}
+	else if (item->ct == CBOR_BYTES || item->ct == CBOR_STRING)
+	{
+		*size = 1 + __cbor_uint_len(item->size);
+		if (item->size > ((size_t)-1) - *size)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+		*size += item->size;
+	}
+	else if (item->ct == CBOR_BYTES_INDEF || item->ct == CBOR_STRING_INDEF)
+	{
+		// initial byte and break code around the chunks
+		*size = 2;
+		*children = item->count;
+	}
+	else if (item->ct == CBOR_ARRAY || item->ct == CBOR_MAP)
+	{
+		if (item->ct == CBOR_MAP && item->count % 2 == 1)
+		{
+			return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+		}
+
+		*size = 1 + __cbor_uint_len(item->count);
+		*children = item->count;
+	}
+	else if (item->ct == CBOR_SIMPLE)
+	{
+		if (item->v.uint > 23 && item->v.uint < 32)
+		{
+			return CBOR_ERR_SIMPLE_OUT_OF_SCOPE;
+		}
+		*size = 1 + __cbor_uint_len((uint8_t)item->v.uint);
+	}
+	else if (item->ct == CBOR_DOUBLE)
+	{
+		*size = 1 + __cbor_float_len(item->v.dbl);
+	}
+	else // if (item->ct == CBOR_FLOAT)
+	{
+		*size = 1 + __cbor_float_len(item->v.flt);
+	}
+	return CBOR_NO_ERROR;
+}
+
+// checks that chunks of an indefinite-length string are strings of the same type
+static int __cbor_item_chunk(const cbor_t *parent, const cbor_t *item)
+{
+	cbor_type ct = parent->ct == CBOR_BYTES_INDEF ? CBOR_BYTES : CBOR_STRING;
+	return item->ct == ct ? CBOR_NO_ERROR : CBOR_ERR_BYTES_TEXT_MISMATCH;
+}
+
+// 17. encoded size of a document described by its items in pre-order
+int cbor_encoded_size_items(const cbor_t *items, size_t n, size_t *size)
+{
+	size_t total = 0;
+	uint64_t owed = 1;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (owed == 0)
+		{
+			return CBOR_ERR_NOT_ALL_DATA_CONSUMED;
+		}
+
+		size_t len, children;
+		int ret = __cbor_item_size(&items[i], &len, &children);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (len > ((size_t)-1) - total)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		total += len;
+		owed = owed - 1 + children;
+
+		if (items[i].ct == CBOR_BYTES_INDEF || items[i].ct == CBOR_STRING_INDEF)
+		{
+			if (children > n - i - 1)
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			for (size_t j = 1; j <= children; j++)
+			{
+				ret = __cbor_item_chunk(&items[i], &items[i + j]);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+			}
+		}
+	}
+
+	if (owed > 0)
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	*size = total;
+	return CBOR_NO_ERROR;
+}
+
+int __cbor_encode_item(uint8_t *buf, size_t size, size_t *pos, const cbor_t *item)
+{
+	if (item->ct == CBOR_FALSE || item->ct == CBOR_TRUE || item->ct == CBOR_NULL || item->ct == CBOR_UNDEFINED)
+	{
+		return cbor_encode_simple(buf, size, pos, AI_FALSE + (item->ct - CBOR_FALSE));
+	}
+	else if (item->ct == CBOR_UINT)
+	{
+		return __cbor_encode_uint(buf, size, pos, IB_UINT, item->v.uint);
+	}
+	else if (item->ct == CBOR_NEGINT)
+	{
+		return cbor_encode_int(buf, size, pos, item->v.sint);
+	}
+	else if (item->ct == CBOR_BYTES || item->ct == CBOR_STRING)
+	{
+		return __cbor_encode_bytes(buf, size, pos, item->ct == CBOR_BYTES ? IB_BYTES : IB_STRING, item->v.bytes, item->size);
+	}
+	else if (item->ct == CBOR_BYTES_INDEF || item->ct == CBOR_STRING_INDEF)
+	{
+		return __cbor_encode_indef(buf, size, pos, item->ct == CBOR_BYTES_INDEF ? IB_BYTES : IB_STRING);
+	}
+	else if (item->ct == CBOR_ARRAY || item->ct == CBOR_MAP)
+	{
+		return __cbor_encode_uint(buf, size, pos, item->ct == CBOR_ARRAY ? IB_ARRAY : IB_MAP, item->count);
+	}
+	else if (item->ct == CBOR_TAG)
+	{
+		return __cbor_encode_uint(buf, size, pos, IB_TAG, item->v.uint);
+	}
+	else if (item->ct == CBOR_SIMPLE)
+	{
+		return cbor_encode_simple(buf, size, pos, (uint8_t)item->v.uint);
+	}
+	else if (item->ct == CBOR_DOUBLE)
+	{
+		return cbor_encode_float(buf, size, pos, item->v.dbl);
+	}
+	else // if (item->ct == CBOR_FLOAT)
+	{
+		return cbor_encode_float(buf, size, pos, item->v.flt);
+	}
+}
+
+// 18. encode a document described by its items in pre-order
+int cbor_encode_items(uint8_t *buf, size_t size, size_t *pos, const cbor_t *items, size_t n)
+{
+	size_t len;
+	int ret = cbor_encoded_size_items(items, n, &len);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (len > size - *pos)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		ret = __cbor_encode_item(buf, size, pos, &items[i]);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (items[i].ct == CBOR_BYTES_INDEF || items[i].ct == CBOR_STRING_INDEF)
+		{
+			for (size_t j = 0; j < items[i].count; j++)
+			{
+				ret = __cbor_encode_item(buf, size, pos, &items[++i]);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+			}
+
+			buf[(*pos)++] = AI_BRKCD;
+		}
+	}
+	return CBOR_NO_ERROR;
+}
+
+// sign mask of a two's complement integer, all ones for negatives
+#define __cbor_sign_mask(val)		((uint64_t)((int64_t)(val) >> 63))
+
+static size_t __cbor_uint_run_len(const uint64_t *vals, size_t n, bool sign)
+{
+	size_t len = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint64_t val = sign ? vals[i] ^ __cbor_sign_mask(vals[i]) : vals[i];
+		len += 1 + __cbor_code_len[__cbor_uint_code(val)];
+	}
+	return len;
+}
+
+// writes n integers into exactly len bytes of room, negative ones as IB_NEGINT when sign is set
+static void __cbor_uint_run(uint8_t *buf, size_t size, size_t *pos, const uint64_t *vals, size_t n, bool sign, size_t len)
+{
+	// every store writes 9 bytes, the tail is finished by the exact encoder
+	uint8_t *p = buf + *pos;
+	uint8_t *end = p + len;
+	size_t i = 0;
+	for (; i < n && end - p >= 9; i++)
+	{
+		uint64_t mask = sign ? __cbor_sign_mask(vals[i]) : 0;
+		uint64_t val = vals[i] ^ mask;
+		size_t code = __cbor_uint_code(val);
+		p[0] = (uint8_t)((mask & IB_NEGINT) | (code ? 23 + code : val));
+		__cbor_store_uint(p + 1, val, __cbor_code_len[code]);
+		p += 1 + __cbor_code_len[code];
+	}
+
+	*pos = p - buf;
+	for (; i < n; i++)
+	{
+		uint64_t mask = sign ? __cbor_sign_mask(vals[i]) : 0;
+		__cbor_encode_uint(buf, size, pos, (uint8_t)(mask & IB_NEGINT), vals[i] ^ mask);
+	}
+}
+
+static int __cbor_encode_int_array(uint8_t *buf, size_t size, size_t *pos, const uint64_t *vals, size_t n, bool sign)
+{
+	size_t _pos = *pos;
+	int ret = cbor_encode_array(buf, size, pos, n);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	// the exact length is only needed when the worst case does not fit
+	size_t len = (size - *pos) / 9 >= n ? size - *pos : __cbor_uint_run_len(vals, n, sign);
+	if (len > size - *pos)
+	{
+		*pos = _pos;
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	__cbor_uint_run(buf, size, pos, vals, n, sign, len);
+	return CBOR_NO_ERROR;
+}
+
+// 19. encode array of unsigned integers
+int cbor_encode_uint_array(uint8_t *buf, size_t size, size_t *pos, const uint64_t *vals, size_t n)
+{
+	return __cbor_encode_int_array(buf, size, pos, vals, n, false);
+}
+
+// 20. encode array of signed integers
+int cbor_encode_int_array(uint8_t *buf, size_t size, size_t *pos, const int64_t *vals, size_t n)
+{
+	return __cbor_encode_int_array(buf, size, pos, (const uint64_t *)vals, n, true);
+}
+
+// 21. encode array of doubles, each in the shortest of half, float and double
+int cbor_encode_double_array(uint8_t *buf, size_t size, size_t *pos, const double *vals, size_t n)
+{
+	size_t _pos = *pos;
+	int ret = cbor_encode_array(buf, size, pos, n);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	size_t len = 0;
+	for (size_t i = 0; i < n && (size - *pos) / 9 < n; i++)
+	{
+		len += 1 + __cbor_float_len(vals[i]);
+	}
+
+	if (len > size - *pos)
+	{
+		*pos = _pos;
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	uint8_t *p = buf + *pos;
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t flen = __cbor_float_len(vals[i]);
+		if (flen == 8)
+		{
+			*p++ = IB_PRIM | AI_8;
+			dtonb(vals[i], p);
+			p += 8;
+		}
+		else if (flen == 4)
+		{
+			*p++ = IB_PRIM | AI_4;
+			ftonb((float)vals[i], p);
+			p += 4;
+		}
+		else if (vals[i] != 0.0 && isfinite(vals[i]))
+		{
+			half hval = ftoh((float)vals[i]);
+			*p++ = IB_PRIM | AI_2;
+			htonb(hval, p);
+			p += 2;
+		}
+		else
+		{
+			*pos = p - buf;
+			cbor_encode_float(buf, size, pos, vals[i]);
+			p = buf + *pos;
+		}
+	}
+
+	*pos = p - buf;
+	return CBOR_NO_ERROR;
+}
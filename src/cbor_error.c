@@ -35,17 +35,24 @@ const char *cbor_error_text[] = {
 	"CBOR_ERR_BYTES_TEXT_MISMATCH",	// bytes/text mismatch (UTF-8 != ASCII-8BIT) in streaming string
 	"CBOR_ERR_OUT_OF_MEMORY",
 	"CBOR_ERR_SIMPLE_OUT_OF_SCOPE",
+	"CBOR_ERR_CHUNK_INDEX_OUT_OF_BOUNDS",
 	"CBOR_ERR_MT_MISMATCH",
 	"CBOR_ERR_ARRAY_INDEX_OUT_OF_BOUNDS",
-	"CBOR_ERR_MAP_KEY_MISMATCH"
+	"CBOR_ERR_MAP_KEY_MISMATCH",
+	"CBOR_ERR_END_OF_CONTAINER",
+	"CBOR_ERR_DEPTH_EXCEEDED",
+	"CBOR_ERR_IO",
+	"CBOR_ERR_INVALID_TAG_CONTENT",
+	"CBOR_ERR_DUPLICATE_KEY",
+	"CBOR_ERR_NOT_DETERMINISTIC"
 };
 
-const char *cbor_get_error(int errno)
+const char *cbor_get_error(int err)
 {
 	int len = sizeof(cbor_error_text) / sizeof(const char *);
-	if (errno >= 0 && errno < len)
+	if (err >= 0 && err < len)
 	{
-		return cbor_error_text[errno];
+		return cbor_error_text[err];
 	}
 	return NULL;
 }
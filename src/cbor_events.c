@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "fp16.h"
+
+static int __cbor_event_chunk(const cbor_callbacks_t *cb, void *ctx, uint8_t ib_mt, const uint8_t *bytes, size_t len, bool last)
+{
+	if (ib_mt == IB_BYTES)
+	{
+		return cb->on_bytes != NULL ? cb->on_bytes(ctx, bytes, len, last) : CBOR_NO_ERROR;
+	}
+	return cb->on_string_chunk != NULL ? cb->on_string_chunk(ctx, (const char *)bytes, len, last) : CBOR_NO_ERROR;
+}
+
+static int __cbor_event_start(const cbor_callbacks_t *cb, void *ctx, uint8_t ib_mt, size_t count)
+{
+	if (ib_mt == IB_ARRAY)
+	{
+		return cb->on_array_start != NULL ? cb->on_array_start(ctx, count) : CBOR_NO_ERROR;
+	}
+	return cb->on_map_start != NULL ? cb->on_map_start(ctx, count) : CBOR_NO_ERROR;
+}
+
+static int __cbor_event_end(const cbor_callbacks_t *cb, void *ctx, uint8_t ib_mt)
+{
+	if (ib_mt == IB_ARRAY)
+	{
+		return cb->on_array_end != NULL ? cb->on_array_end(ctx) : CBOR_NO_ERROR;
+	}
+	else if (ib_mt == IB_MAP)
+	{
+		return cb->on_map_end != NULL ? cb->on_map_end(ctx) : CBOR_NO_ERROR;
+	}
+	return CBOR_NO_ERROR;
+}
+
+static int __cbor_event_scalar(const cbor_callbacks_t *cb, void *ctx, uint8_t ib_mt, uint8_t ib_ai, uint64_t val)
+{
+	if (ib_mt == IB_UINT)
+	{
+		return cb->on_uint != NULL ? cb->on_uint(ctx, val) : CBOR_NO_ERROR;
+	}
+	else if (ib_mt == IB_NEGINT)
+	{
+		return cb->on_negint != NULL ? cb->on_negint(ctx, (int64_t)~val) : CBOR_NO_ERROR;
+	}
+	else if (ib_mt == IB_TAG)
+	{
+		return cb->on_tag != NULL ? cb->on_tag(ctx, val) : CBOR_NO_ERROR;
+	}
+	else if (ib_ai == AI_2 || ib_ai == AI_4 || ib_ai == AI_8)
+	{
+		if (cb->on_float == NULL)
+		{
+			return CBOR_NO_ERROR;
+		}
+
+		if (ib_ai == AI_2)
+		{
+			return cb->on_float(ctx, htof((half)val));
+		}
+		else if (ib_ai == AI_4)
+		{
+			float f;
+			uint32_t l = (uint32_t)val;
+			memcpy(&f, &l, sizeof(float));
+			return cb->on_float(ctx, f);
+		}
+		else
+		{
+			double d;
+			memcpy(&d, &val, sizeof(double));
+			return cb->on_float(ctx, d);
+		}
+	}
+	return cb->on_simple != NULL ? cb->on_simple(ctx, (uint8_t)val) : CBOR_NO_ERROR;
+}
+
+int cbor_parse_events(const uint8_t *buf, size_t size, size_t *pos, const cbor_callbacks_t *cb, void *ctx)
+{
+	cbor_frame_t stack[CBOR_MAX_DEPTH + 1];
+	size_t depth = 0;
+
+	// the top level holds a single item, CBOR_MAX_DEPTH levels nest below it as in cbor_verify_depth()
+	stack[0].ib_mt = IB_ARRAY;
+	stack[0].indef = false;
+	stack[0].remaining = 1;
+	stack[0].count = 0;
+
+	for (;;)
+	{
+		int ret = CBOR_NO_ERROR;
+		cbor_frame_t *frame = &stack[depth];
+		if (!frame->indef && frame->remaining == 0)
+		{
+			if (depth == 0)
+			{
+				return CBOR_NO_ERROR;
+			}
+
+			depth--;
+			ret = __cbor_event_end(cb, ctx, frame->ib_mt);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+			continue;
+		}
+
+		bool chunked = frame->indef && (frame->ib_mt == IB_BYTES || frame->ib_mt == IB_STRING);
+		if (frame->indef)
+		{
+			if (!ensure_capacity(buf, size, *pos + 1))
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			if (buf[*pos] == AI_BRKCD)
+			{
+				if (frame->ib_mt == IB_MAP && frame->count % 2 == 1)
+				{
+					return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+				}
+
+				++*pos;
+				depth--;
+				ret = chunked \
+					? (frame->count == 0 ? __cbor_event_chunk(cb, ctx, frame->ib_mt, buf + *pos, 0, true) : CBOR_NO_ERROR) \
+					: __cbor_event_end(cb, ctx, frame->ib_mt);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+				continue;
+			}
+
+			if (chunked && (buf[*pos] & 0xe0) != frame->ib_mt)
+			{
+				return CBOR_ERR_BYTES_TEXT_MISMATCH;
+			}
+		}
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		ret = cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		frame->count++;
+		if (!frame->indef)
+		{
+			frame->remaining--;
+		}
+
+		bool push = ib_ai == AI_INDEF || ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG;
+		if (push)
+		{
+			if (ib_mt == IB_MAP && val % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			if (depth >= CBOR_MAX_DEPTH)
+			{
+				return CBOR_ERR_DEPTH_EXCEEDED;
+			}
+
+			cbor_frame_t *child = &stack[++depth];
+			child->ib_mt = ib_mt;
+			child->indef = ib_ai == AI_INDEF;
+			child->remaining = ib_mt == IB_TAG ? 1 : val;
+			child->count = 0;
+		}
+
+		if (ib_mt == IB_ARRAY || ib_mt == IB_MAP)
+		{
+			ret = __cbor_event_start(cb, ctx, ib_mt, ib_ai == AI_INDEF ? CBOR_COUNT_INDEF : (size_t)val);
+		}
+		else if ((ib_mt == IB_BYTES || ib_mt == IB_STRING) && ib_ai != AI_INDEF)
+		{
+			if (val > size - *pos)
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			const uint8_t *bytes = buf + *pos;
+			*pos += val;
+
+			// a chunk is the last one when the break code follows
+			bool last = !chunked || (*pos < size && buf[*pos] == AI_BRKCD);
+			ret = __cbor_event_chunk(cb, ctx, ib_mt, bytes, (size_t)val, last);
+		}
+		else if (ib_mt != IB_BYTES && ib_mt != IB_STRING)
+		{
+			ret = __cbor_event_scalar(cb, ctx, ib_mt, ib_ai, val);
+		}
+
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+
+#define LEN(n)					(n)
+#define INDEF					(IB_CLASS_INDEF | 2)
+#define ERR(e)					((e) << IB_CLASS_ERR_SHIFT)
+
+// ai 0-23 immediate, 24-27 one to eight argument bytes, 28-30 reserved, 31 indefinite length
+#define ROW_ARGS \
+	LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), \
+	LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), \
+	LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), LEN(1), \
+	LEN(2), LEN(3), LEN(5), LEN(9), \
+	ERR(CBOR_ERR_RESERVED_AI), ERR(CBOR_ERR_RESERVED_AI), ERR(CBOR_ERR_RESERVED_AI)
+
+const uint8_t __cbor_ib_table[256] = {
+	ROW_ARGS, ERR(CBOR_ERR_MT_UNDEF_FOR_INDEF),			// unsigned integer
+	ROW_ARGS, ERR(CBOR_ERR_MT_UNDEF_FOR_INDEF),			// negative integer
+	ROW_ARGS, INDEF,									// byte string
+	ROW_ARGS, INDEF,									// text string
+	ROW_ARGS, INDEF,									// array
+	ROW_ARGS, INDEF,									// map
+	ROW_ARGS, ERR(CBOR_ERR_MT_UNDEF_FOR_INDEF),			// tag
+	ROW_ARGS, ERR(CBOR_ERR_BREAK_OUTSIDE_INDEF)			// simple, float and break code
+};
+
+int cbor_read_header(const uint8_t *buf, size_t size, size_t *pos, uint8_t *ib_mt, uint8_t *ib_ai, uint64_t *val)
+{
+	return __cbor_read_header(buf, size, pos, ib_mt, ib_ai, val);
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef CBOR_HEADER_H
+#define CBOR_HEADER_H
+
+#include "cbor.h"
+#include "endian.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// initial byte classes of __cbor_ib_table: header length, indefinite-length flag and error code
+#define IB_CLASS_LEN_MASK									0x0f
+#define IB_CLASS_INDEF										0x10
+#define IB_CLASS_ERR_SHIFT									5
+
+extern const uint8_t __cbor_ib_table[256];
+
+static inline int __cbor_read_header(const uint8_t *buf, size_t size, size_t *pos, uint8_t *ib_mt, uint8_t *ib_ai, uint64_t *val)
+{
+	if (!ensure_capacity(buf, size, *pos + 1))
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	// immediate arguments are valid under every major type and skip the table
+	const uint8_t *p = buf + *pos;
+	if ((*p & 0x1f) < AI_1)
+	{
+		*ib_mt = *p & 0xe0;
+		*ib_ai = *p & 0x1f;
+		*val = *ib_ai;
+		++*pos;
+		return CBOR_NO_ERROR;
+	}
+
+	uint8_t ib_class = __cbor_ib_table[*p];
+	if (ib_class >> IB_CLASS_ERR_SHIFT)
+	{
+		return ib_class >> IB_CLASS_ERR_SHIFT;
+	}
+
+	size_t head = ib_class & IB_CLASS_LEN_MASK;
+	if (size - *pos < head)
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	*ib_mt = *p & 0xe0;
+	*ib_ai = *p & 0x1f;
+	if (ib_class & IB_CLASS_INDEF)
+	{
+		// a break code or an item has to follow
+		head = 1;
+		*val = 0;
+	}
+	else if (size - *pos >= 9)
+	{
+		// the argument is the top of an unaligned 8-byte load
+		*val = nbtoll(p + 1) >> ((9 - head) << 3);
+	}
+	else
+	{
+		*val = 0;
+		for (size_t i = 1; i < head; i++)
+		{
+			*val = (*val << 8) | p[i];
+		}
+	}
+
+	*pos += head;
+	return CBOR_NO_ERROR;
+}
+
+// integers and simple values with an immediate argument, the header is the whole item
+static inline bool __cbor_is_immediate(uint8_t ib)
+{
+	uint8_t ib_mt = ib & 0xe0;
+	return (ib & 0x1f) < AI_1 && (ib_mt == IB_UINT || ib_mt == IB_NEGINT || ib_mt == IB_PRIM);
+}
+
+// length of the run of immediate items at the start of buf
+size_t __cbor_scan_immediates(const uint8_t *buf, size_t size);
+
+// cbor_decode() and cbor_decode_tag() taking tag nodes from allocator, never NULL
+int __cbor_decode(const uint8_t *buf, size_t size, size_t *pos, cbor_t *cbor, const cbor_allocator_t *allocator);
+int __cbor_decode_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag, cbor_t *cbor, const cbor_allocator_t *allocator);
+
+// header of an item of a cbor_encode_items() description, or the whole item for leaves
+int __cbor_encode_item(uint8_t *buf, size_t size, size_t *pos, const cbor_t *item);
+
+// appends bytes to the output of a writer, payloads of an iovec writer may be referenced in place
+int __cbor_writer_put(cbor_writer_t *writer, const void *bytes, size_t len);
+// the same, always copying, for bytes that do not outlive the call
+int __cbor_writer_copy(cbor_writer_t *writer, const void *bytes, size_t len);
+
+// checks that the item at *pos is valid content for a typed array tag, without consuming it
+int __cbor_typed_array_check(const uint8_t *buf, size_t size, size_t pos, uint64_t tag);
+// elements of a typed array tag are in host byte order
+bool __cbor_typed_array_native(uint64_t tag);
+// copies count elements of width bytes, reversing the byte order of each
+void __cbor_typed_array_swap(void *dest, const void *src, size_t width, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* CBOR_HEADER_H */
@@ -0,0 +1,922 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+#include "fp16.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// encodings of byte strings, RFC 8949 3.4.5.2
+#define JSON_BASE64URL				0
+#define JSON_BASE64					1
+#define JSON_BASE16					2
+
+// runs of at least this many bytes are handed to the writer in place
+#define JSON_RUN_IN_PLACE			64
+
+/** Container or tag being converted by cbor_to_json() */
+typedef struct
+{
+	uint8_t ib_mt;
+	bool indef;
+	/** The content of a tag stands for a map key */
+	bool key;
+	/** The content of a tag is a negative bignum */
+	bool tilde;
+	/** JSON_BASE* of the byte strings within */
+	uint8_t hint;
+	uint64_t remaining;
+	uint64_t count;
+} __cbor_json_frame_t;
+
+/** Byte string being encoded, the bytes of an incomplete group carried over to the next chunk */
+typedef struct
+{
+	uint8_t hint;
+	uint8_t carry[3];
+	size_t carry_len;
+} __cbor_json_base_t;
+
+static const char __cbor_base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char __cbor_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char __cbor_base16[] = "0123456789ABCDEF";
+
+// escape of each byte of a string, 0 for none and 'u' for \u00XX
+static const char __cbor_json_escape[256] = {
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+	0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0
+};
+
+static const char __cbor_digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static inline int __cbor_json_put(cbor_writer_t *writer, const void *bytes, size_t len)
+{
+	if (writer->size - writer->pos >= len)
+	{
+		memcpy(writer->buf + writer->pos, bytes, len);
+		writer->pos += len;
+		return CBOR_NO_ERROR;
+	}
+	return __cbor_writer_copy(writer, bytes, len);
+}
+
+static inline int __cbor_json_char(cbor_writer_t *writer, char c)
+{
+	if (writer->size > writer->pos)
+	{
+		writer->buf[writer->pos++] = (uint8_t)c;
+		return CBOR_NO_ERROR;
+	}
+	return __cbor_writer_copy(writer, &c, 1);
+}
+
+// decimal digits of val at the end of a buffer of 20 bytes, returns the first
+static char *__cbor_json_utoa(char *end, uint64_t val)
+{
+	while (val >= 100)
+	{
+		const char *d = __cbor_digits + (val % 100) * 2;
+		val /= 100;
+		*--end = d[1];
+		*--end = d[0];
+	}
+
+	if (val >= 10)
+	{
+		*--end = __cbor_digits[val * 2 + 1];
+		*--end = __cbor_digits[val * 2];
+	}
+	else
+	{
+		*--end = (char)('0' + val);
+	}
+	return end;
+}
+
+// the negative integer is -1 - val
+static int __cbor_json_int(cbor_writer_t *writer, uint64_t val, bool negative, bool key)
+{
+	char tmp[24];
+	char *end = tmp + sizeof(tmp), *p = end;
+	if (key)
+	{
+		*--p = '"';
+	}
+
+	if (negative && val == UINT64_MAX)
+	{
+		// -2^64 does not fit the argument
+		static const char min[] = "18446744073709551616";
+		p -= sizeof(min) - 1;
+		memcpy(p, min, sizeof(min) - 1);
+	}
+	else
+	{
+		p = __cbor_json_utoa(p, val + negative);
+	}
+
+	if (negative)
+	{
+		*--p = '-';
+	}
+
+	if (key)
+	{
+		*--p = '"';
+	}
+	return __cbor_json_put(writer, p, end - p);
+}
+
+/** Unnormalized binary floating point number f * 2^e, the working type of Grisu2 */
+typedef struct
+{
+	uint64_t f;
+	int e;
+} __cbor_diyfp_t;
+
+/** Cached power of ten 10^k ~ f * 2^e */
+typedef struct
+{
+	uint64_t f;
+	int e;
+	int k;
+} __cbor_cached_power_t;
+
+// range of the binary exponent of the scaled values, leaves the integral part of a 32-bit digit run
+#define GRISU_ALPHA					-60
+#define GRISU_GAMMA					-32
+
+// 10^k for k = -348, -340, ..., 340, rounded to nearest
+#define GRISU_MIN_DEC_EXP			-348
+#define GRISU_DEC_EXP_STEP			8
+
+static const __cbor_cached_power_t __cbor_cached_powers[] = {
+	{ 0xFA8FD5A0081C0288, -1220, -348 }, { 0xBAAEE17FA23EBF76, -1193, -340 },
+	{ 0x8B16FB203055AC76, -1166, -332 }, { 0xCF42894A5DCE35EA, -1140, -324 },
+	{ 0x9A6BB0AA55653B2D, -1113, -316 }, { 0xE61ACF033D1A45DF, -1087, -308 },
+	{ 0xAB70FE17C79AC6CA, -1060, -300 }, { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+	{ 0xBE5691EF416BD60C, -1007, -284 }, { 0x8DD01FAD907FFC3C, -980, -276 },
+	{ 0xD3515C2831559A83, -954, -268 }, { 0x9D71AC8FADA6C9B5, -927, -260 },
+	{ 0xEA9C227723EE8BCB, -901, -252 }, { 0xAECC49914078536D, -874, -244 },
+	{ 0x823C12795DB6CE57, -847, -236 }, { 0xC21094364DFB5637, -821, -228 },
+	{ 0x9096EA6F3848984F, -794, -220 }, { 0xD77485CB25823AC7, -768, -212 },
+	{ 0xA086CFCD97BF97F4, -741, -204 }, { 0xEF340A98172AACE5, -715, -196 },
+	{ 0xB23867FB2A35B28E, -688, -188 }, { 0x84C8D4DFD2C63F3B, -661, -180 },
+	{ 0xC5DD44271AD3CDBA, -635, -172 }, { 0x936B9FCEBB25C996, -608, -164 },
+	{ 0xDBAC6C247D62A584, -582, -156 }, { 0xA3AB66580D5FDAF6, -555, -148 },
+	{ 0xF3E2F893DEC3F126, -529, -140 }, { 0xB5B5ADA8AAFF80B8, -502, -132 },
+	{ 0x87625F056C7C4A8B, -475, -124 }, { 0xC9BCFF6034C13053, -449, -116 },
+	{ 0x964E858C91BA2655, -422, -108 }, { 0xDFF9772470297EBD, -396, -100 },
+	{ 0xA6DFBD9FB8E5B88F, -369, -92 }, { 0xF8A95FCF88747D94, -343, -84 },
+	{ 0xB94470938FA89BCF, -316, -76 }, { 0x8A08F0F8BF0F156B, -289, -68 },
+	{ 0xCDB02555653131B6, -263, -60 }, { 0x993FE2C6D07B7FAC, -236, -52 },
+	{ 0xE45C10C42A2B3B06, -210, -44 }, { 0xAA242499697392D3, -183, -36 },
+	{ 0xFD87B5F28300CA0E, -157, -28 }, { 0xBCE5086492111AEB, -130, -20 },
+	{ 0x8CBCCC096F5088CC, -103, -12 }, { 0xD1B71758E219652C, -77, -4 },
+	{ 0x9C40000000000000, -50, 4 }, { 0xE8D4A51000000000, -24, 12 },
+	{ 0xAD78EBC5AC620000, 3, 20 }, { 0x813F3978F8940984, 30, 28 },
+	{ 0xC097CE7BC90715B3, 56, 36 }, { 0x8F7E32CE7BEA5C70, 83, 44 },
+	{ 0xD5D238A4ABE98068, 109, 52 }, { 0x9F4F2726179A2245, 136, 60 },
+	{ 0xED63A231D4C4FB27, 162, 68 }, { 0xB0DE65388CC8ADA8, 189, 76 },
+	{ 0x83C7088E1AAB65DB, 216, 84 }, { 0xC45D1DF942711D9A, 242, 92 },
+	{ 0x924D692CA61BE758, 269, 100 }, { 0xDA01EE641A708DEA, 295, 108 },
+	{ 0xA26DA3999AEF774A, 322, 116 }, { 0xF209787BB47D6B85, 348, 124 },
+	{ 0xB454E4A179DD1877, 375, 132 }, { 0x865B86925B9BC5C2, 402, 140 },
+	{ 0xC83553C5C8965D3D, 428, 148 }, { 0x952AB45CFA97A0B3, 455, 156 },
+	{ 0xDE469FBD99A05FE3, 481, 164 }, { 0xA59BC234DB398C25, 508, 172 },
+	{ 0xF6C69A72A3989F5C, 534, 180 }, { 0xB7DCBF5354E9BECE, 561, 188 },
+	{ 0x88FCF317F22241E2, 588, 196 }, { 0xCC20CE9BD35C78A5, 614, 204 },
+	{ 0x98165AF37B2153DF, 641, 212 }, { 0xE2A0B5DC971F303A, 667, 220 },
+	{ 0xA8D9D1535CE3B396, 694, 228 }, { 0xFB9B7CD9A4A7443C, 720, 236 },
+	{ 0xBB764C4CA7A44410, 747, 244 }, { 0x8BAB8EEFB6409C1A, 774, 252 },
+	{ 0xD01FEF10A657842C, 800, 260 }, { 0x9B10A4E5E9913129, 827, 268 },
+	{ 0xE7109BFBA19C0C9D, 853, 276 }, { 0xAC2820D9623BF429, 880, 284 },
+	{ 0x80444B5E7AA7CF85, 907, 292 }, { 0xBF21E44003ACDD2D, 933, 300 },
+	{ 0x8E679C2F5E44FF8F, 960, 308 }, { 0xD433179D9C8CB841, 986, 316 },
+	{ 0x9E19DB92B4E31BA9, 1013, 324 }, { 0xEB96BF6EBADF77D9, 1039, 332 },
+	{ 0xAF87023B9BF0EE6B, 1066, 340 }
+};
+
+static inline __cbor_diyfp_t __cbor_diyfp_mul(__cbor_diyfp_t x, __cbor_diyfp_t y)
+{
+	// upper 64 bits of the 128-bit product, rounded half up
+	uint64_t x_lo = x.f & 0xffffffffu, x_hi = x.f >> 32;
+	uint64_t y_lo = y.f & 0xffffffffu, y_hi = y.f >> 32;
+	uint64_t p0 = x_lo * y_lo, p1 = x_lo * y_hi, p2 = x_hi * y_lo, p3 = x_hi * y_hi;
+	uint64_t q = (p0 >> 32) + (p1 & 0xffffffffu) + (p2 & 0xffffffffu) + (1u << 31);
+	__cbor_diyfp_t r = { p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64 };
+	return r;
+}
+
+static inline __cbor_diyfp_t __cbor_diyfp_normalize(__cbor_diyfp_t x)
+{
+	int shift = __builtin_clzll(x.f);
+	x.f <<= shift;
+	x.e -= shift;
+	return x;
+}
+
+// rounds the last digit towards w while the result stays within the boundaries
+static inline void __cbor_grisu_round(char *buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+	while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+	{
+		buf[len - 1]--;
+		rest += ten_k;
+	}
+}
+
+// number of digits Grisu2 generates for the interval below upper, delta wide
+static int __cbor_grisu_len(uint64_t upper, uint64_t delta, int shift)
+{
+	uint64_t one = (uint64_t)1 << shift;
+	uint32_t p1 = (uint32_t)(upper >> shift);
+	uint64_t p2 = upper & (one - 1);
+
+	uint32_t pow10 = 1;
+	int n = 1;
+	while (n < 10 && p1 >= pow10 * 10)
+	{
+		pow10 *= 10;
+		n++;
+	}
+
+	int len = 0;
+	while (n > 0)
+	{
+		p1 %= pow10;
+		n--;
+		len++;
+		if (((uint64_t)p1 << shift) + p2 <= delta)
+		{
+			return len;
+		}
+		pow10 /= 10;
+	}
+
+	for (;;)
+	{
+		p2 = (p2 * 10) & (one - 1);
+		delta *= 10;
+		len++;
+		if (p2 <= delta)
+		{
+			return len;
+		}
+	}
+}
+
+// digits of a positive finite value of the given precision that read back the same, buf * 10^*exp is the
+// value; *min_len is a lower bound of the shortest length, the result is the shortest when they are equal
+static int __cbor_grisu2(char *buf, int *exp, int *min_len, uint64_t bits, int precision, int bias)
+{
+	// value and the boundaries halfway to its neighbours
+	const uint64_t hidden = (uint64_t)1 << (precision - 1);
+	uint64_t frac = bits & (hidden - 1);
+	int biased = (int)(bits >> (precision - 1));
+	__cbor_diyfp_t v = biased == 0 ? (__cbor_diyfp_t){ frac, 1 - bias } : (__cbor_diyfp_t){ frac + hidden, biased - bias };
+	__cbor_diyfp_t m_plus = __cbor_diyfp_normalize((__cbor_diyfp_t){ 2 * v.f + 1, v.e - 1 });
+	__cbor_diyfp_t m_minus = frac == 0 && biased > 1 ? (__cbor_diyfp_t){ 4 * v.f - 1, v.e - 2 } : (__cbor_diyfp_t){ 2 * v.f - 1, v.e - 1 };
+	m_minus.f <<= m_minus.e - m_plus.e;
+	m_minus.e = m_plus.e;
+	v = __cbor_diyfp_normalize(v);
+
+	// scale by the cached power that brings the exponent to [GRISU_ALPHA, GRISU_GAMMA]
+	int f = GRISU_ALPHA - m_plus.e - 1;
+	int k = f * 78913 / (1 << 18) + (f > 0);
+	const __cbor_cached_power_t *cached = &__cbor_cached_powers[(k - GRISU_MIN_DEC_EXP + GRISU_DEC_EXP_STEP - 1) / GRISU_DEC_EXP_STEP];
+	__cbor_diyfp_t c = { cached->f, cached->e };
+	__cbor_diyfp_t w = __cbor_diyfp_mul(v, c);
+	__cbor_diyfp_t w_plus = __cbor_diyfp_mul(m_plus, c);
+	__cbor_diyfp_t w_minus = __cbor_diyfp_mul(m_minus, c);
+
+	// the true boundaries are within one ulp of the scaled ones: the interval widened by that bounds the
+	// shortest length from below, the interval shrunk by it gives digits that are safe to return
+	int shift = -w_plus.e;
+	*min_len = w_plus.f < UINT64_MAX && w_minus.f > 0 ? __cbor_grisu_len(w_plus.f + 1, w_plus.f - w_minus.f + 2, shift) : 1;
+	w_plus.f--;
+	w_minus.f++;
+	uint64_t delta = w_plus.f - w_minus.f;
+	uint64_t dist = w_plus.f - w.f;
+	*exp = -cached->k;
+
+	uint64_t one = (uint64_t)1 << shift;
+	uint32_t p1 = (uint32_t)(w_plus.f >> shift);
+	uint64_t p2 = w_plus.f & (one - 1);
+	int len = 0;
+
+	// digits of the integral part, p1 is never zero
+	uint32_t pow10 = 1;
+	int n = 1;
+	while (n < 10 && p1 >= pow10 * 10)
+	{
+		pow10 *= 10;
+		n++;
+	}
+	while (n > 0)
+	{
+		buf[len++] = (char)('0' + p1 / pow10);
+		p1 %= pow10;
+		n--;
+
+		uint64_t rest = ((uint64_t)p1 << shift) + p2;
+		if (rest <= delta)
+		{
+			*exp += n;
+			__cbor_grisu_round(buf, len, dist, delta, rest, (uint64_t)pow10 << shift);
+			return len;
+		}
+		pow10 /= 10;
+	}
+
+	// digits of the fractional part
+	for (;;)
+	{
+		p2 *= 10;
+		buf[len++] = (char)('0' + (p2 >> shift));
+		p2 &= one - 1;
+		delta *= 10;
+		dist *= 10;
+		--*exp;
+		if (p2 <= delta)
+		{
+			break;
+		}
+	}
+	__cbor_grisu_round(buf, len, dist, delta, p2, one);
+	return len;
+}
+
+static bool __cbor_json_reads_back(const char *str, double val, bool single)
+{
+	return single ? strtof(str, NULL) == (float)val : strtod(str, NULL) == val;
+}
+
+// the digits of val rounded to len significant ones, or of the next larger such number, when they read back
+// as val; the asymmetric interval at a power of two can exclude the nearest and still hold the one above
+static bool __cbor_json_shortest(char *digits, int *k, int *exp, double val, int len, bool single)
+{
+	char str[40];
+	snprintf(str, sizeof(str), "%.*e", len - 1, val);
+	char *e = strchr(str, 'e');
+	if (!__cbor_json_reads_back(str, val, single))
+	{
+		char *d = e - 1;
+		while (d >= str && (*d == '9' || !isdigit((unsigned char)*d)))
+		{
+			if (*d == '9')
+			{
+				*d = '0';
+			}
+			d--;
+		}
+
+		// 9.99e+X would round up to 1.00e+X+1, shorter than the lengths left to search
+		if (d < str)
+		{
+			return false;
+		}
+
+		(*d)++;
+		if (!__cbor_json_reads_back(str, val, single))
+		{
+			return false;
+		}
+	}
+
+	int n = 0;
+	for (const char *d = str; d < e; d++)
+	{
+		if (isdigit((unsigned char)*d))
+		{
+			digits[n++] = *d;
+		}
+	}
+	while (n > 1 && digits[n - 1] == '0')
+	{
+		n--;
+	}
+	*k = n;
+	*exp = atoi(e + 1) - n + 1;
+	return true;
+}
+
+// shortest digits that read back the same double, or float for halves and floats, laid out as
+// ECMAScript Number.prototype.toString() does
+static size_t __cbor_json_format(char *buf, double val, bool single)
+{
+	// both zeros print as 0, like JSON.stringify()
+	char *p = buf;
+	if (val < 0.0)
+	{
+		*p++ = '-';
+		val = -val;
+	}
+
+	if (val < 9007199254740992.0 && val == (double)(uint64_t)val)
+	{
+		char tmp[24];
+		char *end = tmp + sizeof(tmp);
+		char *d = __cbor_json_utoa(end, (uint64_t)val);
+		memcpy(p, d, end - d);
+		return p + (end - d) - buf;
+	}
+
+	char digits[24];
+	int exp, k, min_len;
+	if (single)
+	{
+		float flt = (float)val;
+		uint32_t bits;
+		memcpy(&bits, &flt, sizeof(bits));
+		k = __cbor_grisu2(digits, &exp, &min_len, bits, 24, 150);
+	}
+	else
+	{
+		uint64_t bits;
+		memcpy(&bits, &val, sizeof(bits));
+		k = __cbor_grisu2(digits, &exp, &min_len, bits, 53, 1075);
+	}
+
+	// Grisu2 could not prove its digits are the shortest, search the lengths it left open
+	for (int len = min_len; len < k; len++)
+	{
+		if (__cbor_json_shortest(digits, &k, &exp, val, len, single))
+		{
+			break;
+		}
+	}
+
+	// n is the position of the decimal point relative to the first digit
+	int n = k + exp;
+	if (k <= n && n <= 21)
+	{
+		memcpy(p, digits, k);
+		memset(p + k, '0', n - k);
+		p += n;
+	}
+	else if (0 < n && n <= 21)
+	{
+		memcpy(p, digits, n);
+		p[n] = '.';
+		memcpy(p + n + 1, digits + n, k - n);
+		p += k + 1;
+	}
+	else if (-6 < n && n <= 0)
+	{
+		memcpy(p, "0.", 2);
+		memset(p + 2, '0', -n);
+		memcpy(p + 2 - n, digits, k);
+		p += 2 - n + k;
+	}
+	else
+	{
+		*p++ = digits[0];
+		if (k > 1)
+		{
+			*p++ = '.';
+			memcpy(p, digits + 1, k - 1);
+			p += k - 1;
+		}
+		*p++ = 'e';
+		*p++ = n > 0 ? '+' : '-';
+		char tmp[4];
+		char *end = tmp + sizeof(tmp);
+		char *d = __cbor_json_utoa(end, (uint64_t)(n > 0 ? n - 1 : 1 - n));
+		memcpy(p, d, end - d);
+		p += end - d;
+	}
+	return p - buf;
+}
+
+static int __cbor_json_float(cbor_writer_t *writer, double val, bool single, bool key)
+{
+	// non-finite values have no JSON number, null is the substitute
+	if (!isfinite(val))
+	{
+		return key ? __cbor_json_put(writer, "\"null\"", 6) : __cbor_json_put(writer, "null", 4);
+	}
+
+	char tmp[48];
+	size_t len = key;
+	tmp[0] = '"';
+	len += __cbor_json_format(tmp + len, val, single);
+	if (key)
+	{
+		tmp[len++] = '"';
+	}
+	return __cbor_json_put(writer, tmp, len);
+}
+
+// length of the run of bytes at the start of str that need no escaping
+static inline size_t __cbor_json_safe_len(const uint8_t *str, size_t len)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1f);
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(str + i));
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+		special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+		int mask = _mm_movemask_epi8(special);
+		if (mask != 0)
+		{
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	while (i < len && !__cbor_json_escape[str[i]])
+	{
+		i++;
+	}
+	return i;
+}
+
+// escaped text between the quotes of a JSON string, the bytes are taken as UTF-8 as they are
+static int __cbor_json_text(cbor_writer_t *writer, const uint8_t *str, size_t len)
+{
+	while (len > 0)
+	{
+		size_t run = __cbor_json_safe_len(str, len);
+		int ret = run >= JSON_RUN_IN_PLACE ? __cbor_writer_put(writer, str, run) : __cbor_json_put(writer, str, run);
+		if (ret != CBOR_NO_ERROR || run == len)
+		{
+			return ret;
+		}
+
+		char esc[6] = { '\\', __cbor_json_escape[str[run]], '0', '0', 0, 0 };
+		size_t esc_len = 2;
+		if (esc[1] == 'u')
+		{
+			esc[4] = __cbor_base16[str[run] >> 4];
+			esc[5] = __cbor_base16[str[run] & 0x0f];
+			esc_len = 6;
+		}
+
+		ret = __cbor_json_put(writer, esc, esc_len);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		str += run + 1;
+		len -= run + 1;
+	}
+	return CBOR_NO_ERROR;
+}
+
+// one chunk of a byte string in the encoding of base->hint
+static int __cbor_json_base(cbor_writer_t *writer, __cbor_json_base_t *base, const uint8_t *bytes, size_t len)
+{
+	char out[1024];
+	size_t n = 0;
+	if (base->hint == JSON_BASE16)
+	{
+		for (size_t i = 0; i < len; i++)
+		{
+			if (n + 2 > sizeof(out))
+			{
+				int ret = __cbor_json_put(writer, out, n);
+				if (ret != CBOR_NO_ERROR)
+				{
+					return ret;
+				}
+				n = 0;
+			}
+
+			out[n++] = __cbor_base16[bytes[i] >> 4];
+			out[n++] = __cbor_base16[bytes[i] & 0x0f];
+		}
+		return __cbor_json_put(writer, out, n);
+	}
+
+	const char *alphabet = base->hint == JSON_BASE64 ? __cbor_base64 : __cbor_base64url;
+	while (base->carry_len + len >= 3)
+	{
+		// the group left over from the previous chunk goes first
+		const uint8_t *group = bytes;
+		if (base->carry_len > 0)
+		{
+			memcpy(base->carry + base->carry_len, bytes, 3 - base->carry_len);
+			bytes += 3 - base->carry_len;
+			len -= 3 - base->carry_len;
+			base->carry_len = 0;
+			group = base->carry;
+		}
+		else
+		{
+			bytes += 3;
+			len -= 3;
+		}
+
+		if (n + 4 > sizeof(out))
+		{
+			int ret = __cbor_json_put(writer, out, n);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+			n = 0;
+		}
+
+		uint32_t bits = ((uint32_t)group[0] << 16) | ((uint32_t)group[1] << 8) | group[2];
+		out[n++] = alphabet[bits >> 18];
+		out[n++] = alphabet[(bits >> 12) & 0x3f];
+		out[n++] = alphabet[(bits >> 6) & 0x3f];
+		out[n++] = alphabet[bits & 0x3f];
+	}
+
+	memcpy(base->carry + base->carry_len, bytes, len);
+	base->carry_len += len;
+	return __cbor_json_put(writer, out, n);
+}
+
+// the last partial group, padded for classic base64 only
+static int __cbor_json_base_end(cbor_writer_t *writer, __cbor_json_base_t *base)
+{
+	if (base->carry_len == 0)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	const char *alphabet = base->hint == JSON_BASE64 ? __cbor_base64 : __cbor_base64url;
+	uint32_t bits = ((uint32_t)base->carry[0] << 16) | (base->carry_len > 1 ? (uint32_t)base->carry[1] << 8 : 0);
+	char out[4] = { alphabet[bits >> 18], alphabet[(bits >> 12) & 0x3f], alphabet[(bits >> 6) & 0x3f], '=' };
+	size_t n = base->carry_len + 1;
+	if (base->hint == JSON_BASE64)
+	{
+		out[2] = base->carry_len > 1 ? out[2] : '=';
+		n = 4;
+	}
+	return __cbor_json_put(writer, out, n);
+}
+
+// a definite or indefinite-length string whose header has been read, chunks go out one after the other
+static int __cbor_json_string(const uint8_t *buf, size_t size, size_t *pos, cbor_writer_t *writer, uint8_t ib_mt, uint8_t ib_ai, uint64_t val, const __cbor_json_frame_t *frame)
+{
+	__cbor_json_base_t base = { frame->hint, { 0 }, 0 };
+	int ret = __cbor_json_char(writer, '"');
+	if (ret == CBOR_NO_ERROR && frame->tilde && ib_mt == IB_BYTES)
+	{
+		ret = __cbor_json_char(writer, '~');
+	}
+
+	for (bool indef = ib_ai == AI_INDEF; ret == CBOR_NO_ERROR; )
+	{
+		if (indef)
+		{
+			if (!ensure_capacity(buf, size, *pos + 1))
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			if (buf[*pos] == AI_BRKCD)
+			{
+				++*pos;
+				break;
+			}
+
+			uint8_t chunk_mt;
+			ret = __cbor_read_header(buf, size, pos, &chunk_mt, &ib_ai, &val);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			if (chunk_mt != ib_mt)
+			{
+				return CBOR_ERR_BYTES_TEXT_MISMATCH;
+			}
+
+			if (ib_ai == AI_INDEF)
+			{
+				return CBOR_ERR_MT_UNDEF_FOR_INDEF;
+			}
+		}
+
+		if (val > size - *pos)
+		{
+			return CBOR_ERR_OUT_OF_DATA;
+		}
+
+		ret = ib_mt == IB_STRING \
+			? __cbor_json_text(writer, buf + *pos, (size_t)val) \
+			: __cbor_json_base(writer, &base, buf + *pos, (size_t)val);
+		*pos += val;
+
+		if (!indef)
+		{
+			break;
+		}
+	}
+
+	if (ret == CBOR_NO_ERROR && ib_mt == IB_BYTES)
+	{
+		ret = __cbor_json_base_end(writer, &base);
+	}
+	return ret == CBOR_NO_ERROR ? __cbor_json_char(writer, '"') : ret;
+}
+
+static int __cbor_json_simple(cbor_writer_t *writer, uint8_t ib_ai, uint64_t val, bool key)
+{
+	if (ib_ai == AI_2 || ib_ai == AI_4 || ib_ai == AI_8)
+	{
+		double dbl;
+		if (ib_ai == AI_2)
+		{
+			dbl = htof((half)val);
+		}
+		else if (ib_ai == AI_4)
+		{
+			float flt;
+			uint32_t l = (uint32_t)val;
+			memcpy(&flt, &l, sizeof(flt));
+			dbl = flt;
+		}
+		else
+		{
+			memcpy(&dbl, &val, sizeof(dbl));
+		}
+		return __cbor_json_float(writer, dbl, ib_ai != AI_8, key);
+	}
+
+	// undefined and the other simple values become null
+	const char *text = ib_ai == AI_FALSE ? "\"false\"" : ib_ai == AI_TRUE ? "\"true\"" : "\"null\"";
+	size_t len = strlen(text);
+	return key ? __cbor_json_put(writer, text, len) : __cbor_json_put(writer, text + 1, len - 2);
+}
+
+int cbor_to_json(const uint8_t *buf, size_t size, size_t *pos, cbor_writer_t *writer)
+{
+	__cbor_json_frame_t stack[CBOR_MAX_DEPTH];
+	size_t depth = 0;
+
+	// the top level is a tag-like frame of one item, no brackets or separators
+	__cbor_json_frame_t frame;
+	frame.ib_mt = IB_TAG;
+	frame.indef = false;
+	frame.key = false;
+	frame.tilde = false;
+	frame.hint = JSON_BASE64URL;
+	frame.remaining = 1;
+	frame.count = 0;
+
+	for (;;)
+	{
+		bool end = !frame.indef && frame.remaining == 0;
+		if (frame.indef)
+		{
+			if (!ensure_capacity(buf, size, *pos + 1))
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+			end = buf[*pos] == AI_BRKCD;
+		}
+
+		int ret;
+		if (end)
+		{
+			if (depth == 0)
+			{
+				return CBOR_NO_ERROR;
+			}
+
+			if (frame.indef && frame.ib_mt == IB_MAP && frame.count % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			*pos += frame.indef;
+			ret = frame.ib_mt == IB_ARRAY ? __cbor_json_char(writer, ']') \
+				: frame.ib_mt == IB_MAP ? __cbor_json_char(writer, '}') \
+				: CBOR_NO_ERROR;
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			frame = stack[--depth];
+			continue;
+		}
+
+		// separators and the position of a key, tags pass theirs on to the content
+		bool key = frame.ib_mt == IB_MAP ? frame.count % 2 == 0 : frame.ib_mt == IB_TAG && frame.key;
+		if ((frame.ib_mt == IB_ARRAY || frame.ib_mt == IB_MAP) && frame.count > 0)
+		{
+			ret = __cbor_json_char(writer, key || frame.ib_mt == IB_ARRAY ? ',' : ':');
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		frame.count++;
+		frame.remaining -= !frame.indef;
+
+		if (ib_mt == IB_UINT || ib_mt == IB_NEGINT)
+		{
+			ret = __cbor_json_int(writer, val, ib_mt == IB_NEGINT, key);
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			ret = __cbor_json_string(buf, size, pos, writer, ib_mt, ib_ai, val, &frame);
+		}
+		else if (ib_mt == IB_PRIM)
+		{
+			ret = __cbor_json_simple(writer, ib_ai, val, key);
+		}
+		else
+		{
+			if (ib_mt != IB_TAG && key)
+			{
+				// JSON object keys are strings, there is no text for a container
+				return CBOR_ERR_MT_MISMATCH;
+			}
+
+			if (ib_mt == IB_MAP && ib_ai != AI_INDEF && val % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			if (depth >= CBOR_MAX_DEPTH)
+			{
+				return CBOR_ERR_DEPTH_EXCEEDED;
+			}
+
+			if (ib_mt != IB_TAG)
+			{
+				ret = __cbor_json_char(writer, ib_mt == IB_ARRAY ? '[' : '{');
+			}
+
+			stack[depth++] = frame;
+			frame.ib_mt = ib_mt;
+			frame.indef = ib_ai == AI_INDEF;
+			frame.key = key;
+			frame.remaining = ib_mt == IB_TAG ? 1 : val;
+			frame.count = 0;
+
+			// bignums are base64url strings, negative ones with a tilde, tags 21 to 23 pick the encoding
+			frame.tilde = ib_mt == IB_TAG && val == TAG_NEG_BIGNUM;
+			if (ib_mt == IB_TAG && (val == TAG_POS_BIGNUM || val == TAG_NEG_BIGNUM))
+			{
+				frame.hint = JSON_BASE64URL;
+			}
+			else if (ib_mt == IB_TAG && val >= TAG_BASE64URL && val <= TAG_BASE16)
+			{
+				frame.hint = val == TAG_BASE64URL ? JSON_BASE64URL : val == TAG_BASE64 ? JSON_BASE64 : JSON_BASE16;
+			}
+		}
+
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,263 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+
+void cbor_reader_init(cbor_reader_t *reader, const uint8_t *buf, size_t size)
+{
+	reader->buf = buf;
+	reader->size = size;
+	reader->pos = 0;
+	reader->pending = false;
+	reader->depth = 0;
+
+	// the top level holds a single item
+	reader->stack[0].ib_mt = IB_ARRAY;
+	reader->stack[0].indef = false;
+	reader->stack[0].remaining = 1;
+	reader->stack[0].count = 0;
+}
+
+static int __cbor_reader_at_end(cbor_reader_t *reader, cbor_frame_t *frame, bool *end)
+{
+	if (!frame->indef)
+	{
+		*end = frame->remaining == 0;
+		return CBOR_NO_ERROR;
+	}
+
+	if (!ensure_capacity(reader->buf, reader->size, reader->pos + 1))
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	*end = reader->buf[reader->pos] == AI_BRKCD;
+	if (*end && frame->ib_mt == IB_MAP && frame->count % 2 == 1)
+	{
+		return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+	}
+
+	if (!*end && (frame->ib_mt == IB_BYTES || frame->ib_mt == IB_STRING) \
+		&& (reader->buf[reader->pos] & 0xe0) != frame->ib_mt)
+	{
+		return CBOR_ERR_BYTES_TEXT_MISMATCH;
+	}
+	return CBOR_NO_ERROR;
+}
+
+static void __cbor_frame_take(cbor_frame_t *frame)
+{
+	frame->count++;
+	if (!frame->indef)
+	{
+		frame->remaining--;
+	}
+}
+
+// skip the items left in the frame and its break code
+static int __cbor_reader_finish(cbor_reader_t *reader, cbor_frame_t *frame)
+{
+	for (;;)
+	{
+		bool end;
+		int ret = __cbor_reader_at_end(reader, frame, &end);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (end)
+		{
+			break;
+		}
+
+		ret = cbor_verify(reader->buf, reader->size, &reader->pos);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+		__cbor_frame_take(frame);
+	}
+
+	if (frame->indef)
+	{
+		reader->pos++;
+	}
+	return CBOR_NO_ERROR;
+}
+
+int cbor_reader_next(cbor_reader_t *reader, cbor_t *item)
+{
+	if (reader->pending)
+	{
+		reader->pending = false;
+		int ret = __cbor_reader_finish(reader, &reader->head);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+
+	cbor_frame_t *frame = &reader->stack[reader->depth];
+	bool end;
+	int ret = __cbor_reader_at_end(reader, frame, &end);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (end)
+	{
+		return CBOR_ERR_END_OF_CONTAINER;
+	}
+
+	if (!ensure_capacity(reader->buf, reader->size, reader->pos + 1))
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	uint8_t ib_mt = reader->buf[reader->pos] & 0xe0;
+	if (ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
+	{
+		uint8_t ib_ai;
+		uint64_t val;
+		ret = cbor_read_header(reader->buf, reader->size, &reader->pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (ib_mt == IB_MAP && val % 2 == 1)
+		{
+			return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+		}
+
+		if (ib_mt == IB_TAG)
+		{
+			item->ct = CBOR_TAG;
+			item->v.uint = val;
+		}
+		else
+		{
+			item->ct = ib_mt == IB_ARRAY ? CBOR_ARRAY : CBOR_MAP;
+			item->v.bytes = reader->buf + reader->pos;
+			item->count = ib_ai == AI_INDEF ? CBOR_COUNT_INDEF : (size_t)val;
+			item->size = 0;
+			item->index = NULL;
+		}
+
+		reader->head.ib_mt = ib_mt;
+		reader->head.indef = ib_ai == AI_INDEF;
+		reader->head.remaining = ib_mt == IB_TAG ? 1 : val;
+		reader->head.count = 0;
+		reader->pending = true;
+	}
+	else
+	{
+		ret = cbor_decode(reader->buf, reader->size, &reader->pos, item);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+
+	__cbor_frame_take(frame);
+	return CBOR_NO_ERROR;
+}
+
+int cbor_reader_enter_container(cbor_reader_t *reader)
+{
+	if (!reader->pending)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	// stack[0] is the top level, CBOR_MAX_DEPTH levels nest below it as in cbor_verify_depth()
+	if (reader->depth >= CBOR_MAX_DEPTH)
+	{
+		return CBOR_ERR_DEPTH_EXCEEDED;
+	}
+
+	reader->stack[++reader->depth] = reader->head;
+	reader->pending = false;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_reader_leave_container(cbor_reader_t *reader)
+{
+	if (reader->depth == 0)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	if (reader->pending)
+	{
+		reader->pending = false;
+		int ret = __cbor_reader_finish(reader, &reader->head);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+
+	int ret = __cbor_reader_finish(reader, &reader->stack[reader->depth]);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	reader->depth--;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_reader_skip(cbor_reader_t *reader)
+{
+	if (reader->pending)
+	{
+		reader->pending = false;
+		return __cbor_reader_finish(reader, &reader->head);
+	}
+
+	cbor_frame_t *frame = &reader->stack[reader->depth];
+	bool end;
+	int ret = __cbor_reader_at_end(reader, frame, &end);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (end)
+	{
+		return CBOR_ERR_END_OF_CONTAINER;
+	}
+
+	ret = cbor_verify(reader->buf, reader->size, &reader->pos);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	__cbor_frame_take(frame);
+	return CBOR_NO_ERROR;
+}
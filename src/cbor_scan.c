@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CBOR_SCAN_X86
+#include <immintrin.h>
+#endif
+
+static size_t __cbor_scan_scalar(const uint8_t *buf, size_t size)
+{
+	size_t i = 0;
+	while (i < size && __cbor_is_immediate(buf[i]))
+	{
+		i++;
+	}
+	return i;
+}
+
+#ifdef CBOR_SCAN_X86
+__attribute__((target("sse2")))
+static size_t __cbor_scan_sse2(const uint8_t *buf, size_t size)
+{
+	const __m128i ai_mask = _mm_set1_epi8(0x1f);
+	const __m128i mt_mask = _mm_set1_epi8((char)0xe0);
+	const __m128i ai_limit = _mm_set1_epi8(AI_1);
+	const __m128i mt_negint = _mm_set1_epi8((char)IB_NEGINT);
+	const __m128i mt_prim = _mm_set1_epi8((char)IB_PRIM);
+
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i ib = _mm_loadu_si128((const __m128i *)(buf + i));
+		__m128i ai = _mm_cmplt_epi8(_mm_and_si128(ib, ai_mask), ai_limit);
+		__m128i mt = _mm_and_si128(ib, mt_mask);
+		__m128i ok = _mm_or_si128(_mm_cmpeq_epi8(mt, _mm_setzero_si128()), \
+			_mm_or_si128(_mm_cmpeq_epi8(mt, mt_negint), _mm_cmpeq_epi8(mt, mt_prim)));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(ai, ok));
+		if (mask != 0xffff)
+		{
+			return i + __builtin_ctz(~mask);
+		}
+	}
+	return i + __cbor_scan_scalar(buf + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t __cbor_scan_avx2(const uint8_t *buf, size_t size)
+{
+	const __m256i ai_mask = _mm256_set1_epi8(0x1f);
+	const __m256i mt_mask = _mm256_set1_epi8((char)0xe0);
+	const __m256i ai_limit = _mm256_set1_epi8(AI_1);
+	const __m256i mt_negint = _mm256_set1_epi8((char)IB_NEGINT);
+	const __m256i mt_prim = _mm256_set1_epi8((char)IB_PRIM);
+
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32)
+	{
+		__m256i ib = _mm256_loadu_si256((const __m256i *)(buf + i));
+		__m256i ai = _mm256_cmpgt_epi8(ai_limit, _mm256_and_si256(ib, ai_mask));
+		__m256i mt = _mm256_and_si256(ib, mt_mask);
+		__m256i ok = _mm256_or_si256(_mm256_cmpeq_epi8(mt, _mm256_setzero_si256()), \
+			_mm256_or_si256(_mm256_cmpeq_epi8(mt, mt_negint), _mm256_cmpeq_epi8(mt, mt_prim)));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(ai, ok));
+		if (mask != 0xffffffff)
+		{
+			return i + __builtin_ctz(~mask);
+		}
+	}
+	return i + __cbor_scan_sse2(buf + i, size - i);
+}
+#endif
+
+size_t __cbor_scan_immediates(const uint8_t *buf, size_t size)
+{
+#ifdef CBOR_SCAN_X86
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return __cbor_scan_avx2(buf, size);
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		return __cbor_scan_sse2(buf, size);
+	}
+#endif
+	return __cbor_scan_scalar(buf, size);
+}
@@ -0,0 +1,191 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+
+void cbor_stream_init(cbor_stream_t *stream)
+{
+	stream->head_len = 0;
+	stream->skip = 0;
+	stream->total = 0;
+	stream->depth = 0;
+
+	// the top level holds a single item
+	stream->stack[0].ib_mt = IB_ARRAY;
+	stream->stack[0].indef = false;
+	stream->stack[0].remaining = 1;
+	stream->stack[0].count = 0;
+}
+
+// header length announced by the initial byte, 0 for reserved values
+static size_t __cbor_head_len(uint8_t ib)
+{
+	uint8_t ib_ai = ib & 0x1f;
+	return (ib_ai < AI_1) ? 1 \
+		: (ib_ai == AI_1) ? 2 \
+		: (ib_ai == AI_2) ? 3 \
+		: (ib_ai == AI_4) ? 5 \
+		: (ib_ai == AI_8) ? 9 \
+		: (ib_ai == AI_INDEF) ? 1 \
+		: 0;
+}
+
+static int __cbor_stream_push(cbor_stream_t *stream, uint8_t ib_mt, bool indef, uint64_t remaining)
+{
+	// stack[0] is the top level, CBOR_MAX_DEPTH levels nest below it as in cbor_verify_depth()
+	if (stream->depth >= CBOR_MAX_DEPTH)
+	{
+		return CBOR_ERR_DEPTH_EXCEEDED;
+	}
+
+	cbor_frame_t *frame = &stream->stack[++stream->depth];
+	frame->ib_mt = ib_mt;
+	frame->indef = indef;
+	frame->remaining = remaining;
+	frame->count = 0;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_stream_feed(cbor_stream_t *stream, const uint8_t *buf, size_t size, size_t *pos, size_t *need)
+{
+	*need = 0;
+	for (;;)
+	{
+		while (stream->depth > 0 && !stream->stack[stream->depth].indef && stream->stack[stream->depth].remaining == 0)
+		{
+			stream->depth--;
+		}
+
+		if (stream->depth == 0 && stream->stack[0].remaining == 0 && stream->skip == 0)
+		{
+			return CBOR_NO_ERROR;
+		}
+
+		if (*pos >= size)
+		{
+			*need = stream->skip > 0 ? (size_t)stream->skip \
+				: stream->head_len > 0 ? __cbor_head_len(stream->head[0]) - stream->head_len \
+				: 1;
+			return CBOR_ERR_OUT_OF_DATA;
+		}
+
+		if (stream->skip > 0)
+		{
+			size_t len = stream->skip > size - *pos ? size - *pos : (size_t)stream->skip;
+			*pos += len;
+			stream->total += len;
+			stream->skip -= len;
+			continue;
+		}
+
+		cbor_frame_t *frame = &stream->stack[stream->depth];
+		if (stream->head_len == 0)
+		{
+			uint8_t ib = buf[*pos];
+			if (frame->indef)
+			{
+				if (ib == AI_BRKCD)
+				{
+					if (frame->ib_mt == IB_MAP && frame->count % 2 == 1)
+					{
+						return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+					}
+
+					++*pos;
+					stream->total++;
+					stream->depth--;
+					continue;
+				}
+
+				if ((frame->ib_mt == IB_BYTES || frame->ib_mt == IB_STRING) && (ib & 0xe0) != frame->ib_mt)
+				{
+					return CBOR_ERR_BYTES_TEXT_MISMATCH;
+				}
+			}
+
+			if (__cbor_head_len(ib) == 0)
+			{
+				return CBOR_ERR_RESERVED_AI;
+			}
+		}
+
+		// headers may be split across pieces, collect them first
+		size_t head_len = __cbor_head_len(stream->head_len > 0 ? stream->head[0] : buf[*pos]);
+		size_t len = head_len - stream->head_len > size - *pos ? size - *pos : head_len - stream->head_len;
+		memcpy(stream->head + stream->head_len, buf + *pos, len);
+		stream->head_len += len;
+		stream->total += len;
+		*pos += len;
+		if (stream->head_len < head_len)
+		{
+			continue;
+		}
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		size_t _pos = 0;
+		stream->head_len = 0;
+		int ret = cbor_read_header(stream->head, sizeof(stream->head), &_pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		frame->count++;
+		if (!frame->indef)
+		{
+			frame->remaining--;
+		}
+
+		if (ib_ai == AI_INDEF)
+		{
+			ret = __cbor_stream_push(stream, ib_mt, true, 0);
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			stream->skip = val;
+		}
+		else if (ib_mt == IB_ARRAY || ib_mt == IB_MAP)
+		{
+			if (ib_mt == IB_MAP && val % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			if (val > 0)
+			{
+				ret = __cbor_stream_push(stream, ib_mt, false, val);
+			}
+		}
+		else if (ib_mt == IB_TAG)
+		{
+			ret = __cbor_stream_push(stream, ib_mt, false, 1);
+		}
+
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+
+#define TAPE_NONE			((size_t)-1)
+
+static cbor_type __cbor_node_type(uint8_t ib_mt, uint8_t ib_ai)
+{
+	switch (ib_mt)
+	{
+		case IB_UINT:
+			return CBOR_UINT;
+		case IB_NEGINT:
+			return CBOR_NEGINT;
+		case IB_BYTES:
+			return ib_ai == AI_INDEF ? CBOR_BYTES_INDEF : CBOR_BYTES;
+		case IB_STRING:
+			return ib_ai == AI_INDEF ? CBOR_STRING_INDEF : CBOR_STRING;
+		case IB_ARRAY:
+			return CBOR_ARRAY;
+		case IB_MAP:
+			return CBOR_MAP;
+		case IB_TAG:
+			return CBOR_TAG;
+		default: // case IB_PRIM:
+			return (ib_ai == AI_FALSE) ? CBOR_FALSE \
+				: (ib_ai == AI_TRUE) ? CBOR_TRUE \
+				: (ib_ai == AI_NULL) ? CBOR_NULL \
+				: (ib_ai == AI_UNDEFINED) ? CBOR_UNDEFINED \
+				: (ib_ai == AI_2 || ib_ai == AI_4) ? CBOR_FLOAT \
+				: (ib_ai == AI_8) ? CBOR_DOUBLE \
+				: CBOR_SIMPLE;
+	}
+}
+
+/*
+ * While a container is open, its node keeps the index of the enclosing open
+ * container in `next` and the number of expected children in `end`, so the
+ * tape itself serves as the nesting stack.
+ */
+static size_t __cbor_tape_close(cbor_node_t *tape, size_t index, size_t end, size_t len)
+{
+	size_t parent = tape[index].next;
+	tape[index].end = end;
+	tape[index].next = len;
+	return parent;
+}
+
+int cbor_parse_tape(const uint8_t *buf, size_t size, size_t *pos, cbor_node_t *tape, size_t cap, size_t *len)
+{
+	size_t open = TAPE_NONE;
+	*len = 0;
+	for (;;)
+	{
+		while (open != TAPE_NONE && (buf[tape[open].head] & 0x1f) != AI_INDEF && tape[open].count == tape[open].end)
+		{
+			open = __cbor_tape_close(tape, open, *pos, *len);
+		}
+
+		if (open == TAPE_NONE && *len > 0)
+		{
+			break;
+		}
+
+		if (open != TAPE_NONE)
+		{
+			cbor_node_t *parent = &tape[open];
+			if ((buf[parent->head] & 0x1f) == AI_INDEF)
+			{
+				if (!ensure_capacity(buf, size, *pos + 1))
+				{
+					return CBOR_ERR_OUT_OF_DATA;
+				}
+
+				if (buf[*pos] == AI_BRKCD)
+				{
+					if (parent->ct == CBOR_MAP && parent->count % 2 == 1)
+					{
+						return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+					}
+
+					open = __cbor_tape_close(tape, open, ++*pos, *len);
+					continue;
+				}
+
+				if ((parent->ct == CBOR_BYTES_INDEF || parent->ct == CBOR_STRING_INDEF) \
+					&& (buf[*pos] & 0xe0) != (buf[parent->head] & 0xe0))
+				{
+					return CBOR_ERR_BYTES_TEXT_MISMATCH;
+				}
+			}
+			parent->count++;
+		}
+
+		if (*len >= cap)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		size_t index = (*len)++;
+		cbor_node_t *node = &tape[index];
+		node->head = *pos;
+
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		int ret = cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		node->ct = __cbor_node_type(ib_mt, ib_ai);
+		node->payload = *pos;
+		node->count = 0;
+
+		if (ib_ai == AI_INDEF || ((ib_mt == IB_ARRAY || ib_mt == IB_MAP) && val > 0) || ib_mt == IB_TAG)
+		{
+			if (ib_mt == IB_MAP && val % 2 == 1)
+			{
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
+
+			node->end = ib_mt == IB_TAG ? 1 : (size_t)val;
+			node->next = open;
+			open = index;
+			continue;
+		}
+
+		if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			if (val > size - *pos)
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			*pos += val;
+		}
+		node->end = *pos;
+		node->next = *len;
+	}
+
+	return CBOR_NO_ERROR;
+}
+
+int cbor_tape_get(const uint8_t *buf, const cbor_node_t *tape, size_t len, size_t index, cbor_t *cbor)
+{
+	if (index >= len)
+	{
+		return CBOR_ERR_ARRAY_INDEX_OUT_OF_BOUNDS;
+	}
+
+	const cbor_node_t *node = &tape[index];
+	if (node->ct == CBOR_ARRAY || node->ct == CBOR_MAP || node->ct == CBOR_BYTES_INDEF || node->ct == CBOR_STRING_INDEF)
+	{
+		cbor->ct = node->ct;
+		cbor->v.bytes = buf + node->payload;
+		cbor->count = node->count;
+		cbor->size = node->end - node->payload;
+		cbor->index = NULL;
+		return CBOR_NO_ERROR;
+	}
+	else if (node->ct == CBOR_TAG)
+	{
+		size_t pos = node->head;
+		uint8_t ib_mt, ib_ai;
+		int ret = cbor_read_header(buf, node->payload, &pos, &ib_mt, &ib_ai, &cbor->v.uint);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		cbor->ct = CBOR_TAG;
+		if (cbor->next == NULL)
+		{
+			cbor->next = cbor_create();
+			if (cbor->next == NULL)
+			{
+				return CBOR_ERR_OUT_OF_MEMORY;
+			}
+		}
+		return cbor_tape_get(buf, tape, len, index + 1, cbor->next);
+	}
+	else
+	{
+		size_t pos = node->head;
+		return cbor_decode(buf, node->end, &pos, cbor);
+	}
+}
+
+int cbor_tape_child(const cbor_node_t *tape, size_t len, size_t index, size_t n, size_t *child)
+{
+	if (index >= len)
+	{
+		return CBOR_ERR_ARRAY_INDEX_OUT_OF_BOUNDS;
+	}
+
+	const cbor_node_t *node = &tape[index];
+	if (node->ct != CBOR_ARRAY && node->ct != CBOR_MAP && node->ct != CBOR_TAG \
+		&& node->ct != CBOR_BYTES_INDEF && node->ct != CBOR_STRING_INDEF)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	if (n >= node->count)
+	{
+		return CBOR_ERR_ARRAY_INDEX_OUT_OF_BOUNDS;
+	}
+
+	size_t i = index + 1;
+	while (n-- > 0)
+	{
+		i = tape[i].next;
+	}
+	*child = i;
+	return CBOR_NO_ERROR;
+}
@@ -0,0 +1,215 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+#include "endian.h"
+#include <string.h>
+
+#define TA_FLOAT					0x10
+#define TA_SIGNED					0x08
+#define TA_LITTLE_ENDIAN			0x04
+
+size_t cbor_typed_array_width(uint64_t tag)
+{
+	if (tag < TAG_TA_UINT8 || tag > TAG_TA_FLOAT128_LE || tag == TAG_TA_SINT8 + TA_LITTLE_ENDIAN)
+	{
+		return 0;
+	}
+
+	// float16 is the smallest float, uint8 and sint8 ignore the byte order bit
+	size_t ll = tag & 0x03;
+	return (tag & TA_FLOAT) ? (size_t)2 << ll : (size_t)1 << ll;
+}
+
+bool __cbor_typed_array_native(uint64_t tag)
+{
+	return cbor_typed_array_width(tag) == 1 || ((tag & TA_LITTLE_ENDIAN) != 0) == is_little_endian();
+}
+
+// copies count elements of width bytes, reversing the bytes of each
+static void __cbor_swap_copy(uint8_t *dest, const uint8_t *src, size_t width, size_t count)
+{
+	for (size_t i = 0; i < count; i++, dest += width, src += width)
+	{
+		for (size_t j = 0; j < width; j++)
+		{
+			dest[j] = src[width - 1 - j];
+		}
+	}
+}
+
+void __cbor_typed_array_swap(void *dest, const void *src, size_t width, size_t count)
+{
+	uint8_t *d = (uint8_t *)dest;
+	const uint8_t *s = (const uint8_t *)src;
+	if (width == 2)
+	{
+		for (size_t i = 0; i < count; i++, d += 2, s += 2)
+		{
+			uint16_t v;
+			memcpy(&v, s, sizeof(v));
+			v = endian_reverse16(v);
+			memcpy(d, &v, sizeof(v));
+		}
+	}
+	else if (width == 4)
+	{
+		for (size_t i = 0; i < count; i++, d += 4, s += 4)
+		{
+			uint32_t v;
+			memcpy(&v, s, sizeof(v));
+			v = endian_reverse32(v);
+			memcpy(d, &v, sizeof(v));
+		}
+	}
+	else if (width == 8)
+	{
+		for (size_t i = 0; i < count; i++, d += 8, s += 8)
+		{
+			uint64_t v;
+			memcpy(&v, s, sizeof(v));
+			v = endian_reverse64(v);
+			memcpy(d, &v, sizeof(v));
+		}
+	}
+	else
+	{
+		__cbor_swap_copy(d, s, width, count);
+	}
+}
+
+int __cbor_typed_array_check(const uint8_t *buf, size_t size, size_t pos, uint64_t tag)
+{
+	size_t width = cbor_typed_array_width(tag);
+	if (width == 0)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	uint8_t ib_mt, ib_ai;
+	uint64_t val;
+	int ret = __cbor_read_header(buf, size, &pos, &ib_mt, &ib_ai, &val);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (ib_mt != IB_BYTES || (ib_ai != AI_INDEF && val % width != 0))
+	{
+		return CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+	return CBOR_NO_ERROR;
+}
+
+int cbor_typed_array_get(const cbor_t *cbor, cbor_typed_array_t *ta)
+{
+	if (cbor->ct != CBOR_TAG || cbor->next == NULL)
+	{
+		return CBOR_ERR_MT_MISMATCH;
+	}
+
+	size_t width = cbor_typed_array_width(cbor->v.uint);
+	if (width == 0)
+	{
+		return CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+
+	if (cbor->next->ct != CBOR_BYTES)
+	{
+		return cbor->next->ct == CBOR_BYTES_INDEF ? CBOR_ERR_MT_UNDEF_FOR_INDEF : CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+
+	if (cbor->next->size % width != 0)
+	{
+		return CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+
+	ta->tag = cbor->v.uint;
+	ta->data = cbor->next->v.bytes;
+	ta->count = cbor->next->size / width;
+	ta->width = width;
+	ta->is_float = (ta->tag & TA_FLOAT) != 0;
+	ta->is_signed = ta->is_float || (ta->tag & TA_SIGNED) != 0;
+	ta->native = __cbor_typed_array_native(ta->tag);
+	return CBOR_NO_ERROR;
+}
+
+int cbor_typed_array_copy(const cbor_typed_array_t *ta, void *dest, size_t cap, size_t *count)
+{
+	*count = ta->count < cap ? ta->count : cap;
+	if (ta->native)
+	{
+		memcpy(dest, ta->data, *count * ta->width);
+	}
+	else
+	{
+		__cbor_typed_array_swap(dest, ta->data, ta->width, *count);
+	}
+	return ta->count <= cap ? CBOR_NO_ERROR : CBOR_ERR_OUT_OF_MEMORY;
+}
+
+int cbor_encode_typed_array(uint8_t *buf, size_t size, size_t *pos, uint64_t tag, const void *data, size_t count)
+{
+	size_t width = cbor_typed_array_width(tag);
+	if (width == 0)
+	{
+		return CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+
+	if (count > ((size_t)-1) / width)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	size_t len = count * width;
+	size_t _pos = *pos;
+	int ret = cbor_encode_tag(buf, size, pos, tag);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = cbor_encode_header(buf, size, pos, IB_BYTES, len);
+	}
+
+	if (ret == CBOR_NO_ERROR && !ensure_capacity(buf, size, *pos + len))
+	{
+		ret = CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	if (ret != CBOR_NO_ERROR)
+	{
+		*pos = _pos;
+		return ret;
+	}
+
+	if (__cbor_typed_array_native(tag))
+	{
+		memcpy(buf + *pos, data, len);
+	}
+	else
+	{
+		__cbor_typed_array_swap(buf + *pos, data, width, count);
+	}
+	*pos += len;
+	return CBOR_NO_ERROR;
+}
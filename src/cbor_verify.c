@@ -23,121 +23,187 @@
 ****************************************************************************/
 
 #include "cbor.h"
+#include "cbor_header.h"
+#include <string.h>
+
+/** Frames of the enclosing levels, on the C stack up to CBOR_MAX_DEPTH and from the allocator beyond */
+typedef struct
+{
+	cbor_frame_t *frames;
+	size_t cap;
+	cbor_frame_t local[CBOR_MAX_DEPTH];
+} __cbor_verify_stack_t;
+
+static int __cbor_verify_depth(const uint8_t *buf, size_t size, size_t *pos, size_t max_depth, __cbor_verify_stack_t *st);
 
 int cbor_verify(const uint8_t *buf, size_t size, size_t *pos)
 {
-	if (buf[*pos] == AI_BRKCD)
+	return cbor_verify_depth(buf, size, pos, (size_t)-1);
+}
+
+int cbor_verify_depth(const uint8_t *buf, size_t size, size_t *pos, size_t max_depth)
+{
+	__cbor_verify_stack_t st;
+	st.frames = st.local;
+	st.cap = CBOR_MAX_DEPTH;
+
+	int ret = __cbor_verify_depth(buf, size, pos, max_depth, &st);
+	if (st.frames != st.local)
+	{
+		const cbor_allocator_t *allocator = cbor_get_allocator();
+		allocator->free(allocator->ctx, st.frames, st.cap * sizeof(cbor_frame_t));
+	}
+	return ret;
+}
+
+// doubles the frames, moving them off the C stack the first time
+static int __cbor_verify_grow(__cbor_verify_stack_t *st)
+{
+	if (st->cap > ((size_t)-1) / 2 / sizeof(cbor_frame_t))
 	{
-		return CBOR_ERR_BREAK_OUTSIDE_INDEF;
+		return CBOR_ERR_OUT_OF_MEMORY;
 	}
 
-	uint8_t ib_mt = buf[*pos] & 0xe0;
-	uint8_t ib_ai = buf[*pos] & 0x1f;
-	if (ib_ai < 28)
+	const cbor_allocator_t *allocator = cbor_get_allocator();
+	size_t cap = st->cap * 2;
+	cbor_frame_t *frames = st->frames == st->local \
+		? (cbor_frame_t *)allocator->alloc(allocator->ctx, cap * sizeof(cbor_frame_t)) \
+		: (cbor_frame_t *)allocator->realloc(allocator->ctx, st->frames, st->cap * sizeof(cbor_frame_t), cap * sizeof(cbor_frame_t));
+	if (frames == NULL)
 	{
-		size_t len = (ib_ai == AI_1) ? 1 \
-			: (ib_ai == AI_2) ? 2 \
-			: (ib_ai == AI_4) ? 4 \
-			: (ib_ai == AI_8) ? 8 \
-			: 0;
-		if (!ensure_capacity(buf, size, *pos + len + 1))
-		{
-			return CBOR_ERR_OUT_OF_DATA;
-		}
-		
-		++*pos;
-		uint64_t val = (len == 1) ? buf[*pos] \
-			: (len == 2) ? nbtos(buf + *pos) \
-			: (len == 4) ? nbtol(buf + *pos) \
-			: (len == 8) ? nbtoll(buf + *pos) \
-			: ib_ai;
-		*pos += len;
-
-		if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	if (st->frames == st->local)
+	{
+		memcpy(frames, st->local, sizeof(st->local));
+	}
+	st->frames = frames;
+	st->cap = cap;
+	return CBOR_NO_ERROR;
+}
+
+static int __cbor_verify_depth(const uint8_t *buf, size_t size, size_t *pos, size_t max_depth, __cbor_verify_stack_t *st)
+{
+	cbor_frame_t *stack = st->frames;
+	size_t depth = 0;
+
+	// the current level lives in locals, enclosing ones are saved on the stack; the top level holds a single item
+	cbor_frame_t frame;
+	frame.ib_mt = IB_ARRAY;
+	frame.indef = false;
+	frame.remaining = 1;
+	frame.count = 0;
+
+	for (;;)
+	{
+		if (!frame.indef)
 		{
-			if (!ensure_capacity(buf, size, *pos + val))
+			if (frame.remaining == 0)
 			{
-				return CBOR_ERR_OUT_OF_DATA;
+				if (depth == 0)
+				{
+					return CBOR_NO_ERROR;
+				}
+
+				frame = stack[--depth];
+				continue;
 			}
-			
-			*pos += val;
 		}
-		else if (ib_mt == IB_ARRAY || ib_mt == IB_MAP)
+		else
 		{
-			if (ib_mt == IB_MAP && val % 2 == 1)
+			if (!ensure_capacity(buf, size, *pos + 1))
 			{
-				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+				return CBOR_ERR_OUT_OF_DATA;
 			}
 
-			for (uint64_t i = 0; i < val; i++)
+			if (buf[*pos] == AI_BRKCD)
 			{
-				int ret = cbor_verify(buf, size, pos);
-				if (ret != CBOR_NO_ERROR)
+				if (frame.ib_mt == IB_MAP && frame.count % 2 == 1)
 				{
-					return ret;
+					return CBOR_ERR_ODD_SIZE_INDEF_MAP;
 				}
+
+				++*pos;
+				frame = stack[--depth];
+				continue;
+			}
+
+			if ((frame.ib_mt == IB_BYTES || frame.ib_mt == IB_STRING) && (buf[*pos] & 0xe0) != frame.ib_mt)
+			{
+				return CBOR_ERR_BYTES_TEXT_MISMATCH;
 			}
 		}
-		else if (ib_mt == IB_TAG)
-		{
-			return cbor_verify_tag(buf, size, pos, val);
-		}
-		return CBOR_NO_ERROR;
-	}
-	else if (ib_ai < AI_INDEF)
-	{
-		return CBOR_ERR_RESERVED_AI;
-	}
-	else // if (ib_ai == AI_INDEF)
-	{
-		if (ib_mt != IB_BYTES && ib_mt != IB_STRING && ib_mt != IB_ARRAY && ib_mt != IB_MAP)
+
+		if (*pos < size && __cbor_is_immediate(buf[*pos]) && !(frame.indef && (frame.ib_mt == IB_BYTES || frame.ib_mt == IB_STRING)))
 		{
-			return CBOR_ERR_MT_UNDEF_FOR_INDEF;
+			// runs of one-byte items can neither fail nor nest, skip them in bulk
+			size_t len = 1;
+			if (*pos + 1 < size && __cbor_is_immediate(buf[*pos + 1]) && (frame.indef || frame.remaining > 1))
+			{
+				len = __cbor_scan_immediates(buf + *pos, size - *pos);
+				if (!frame.indef && len > frame.remaining)
+				{
+					len = (size_t)frame.remaining;
+				}
+			}
+
+			*pos += len;
+			frame.count += len;
+			frame.remaining -= frame.indef ? 0 : len;
+			continue;
 		}
 
-		if (!ensure_capacity(buf, size, *pos + 2))
+		size_t _pos = *pos;
+		uint8_t ib_mt, ib_ai;
+		uint64_t val;
+		int ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+		if (ret != CBOR_NO_ERROR)
 		{
-			return CBOR_ERR_OUT_OF_DATA;
+			return ret;
 		}
 
-		++*pos;
-		if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		frame.count++;
+		frame.remaining -= !frame.indef;
+
+		if (ib_ai == AI_INDEF || ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
 		{
-			while (buf[*pos] != AI_BRKCD)
+			if (ib_mt == IB_MAP && val % 2 == 1)
 			{
-				if ((buf[*pos] & 0xe0) != ib_mt /*|| (buf[*pos] & 0x1f) == AI_INDEF*/)
-				{
-					return CBOR_ERR_BYTES_TEXT_MISMATCH;
-				}
+				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+			}
 
-				int ret = cbor_verify(buf, size, pos);
-				if (ret != CBOR_NO_ERROR)
-				{
-					return ret;
-				}
+			if (depth >= max_depth)
+			{
+				*pos = _pos;
+				return CBOR_ERR_DEPTH_EXCEEDED;
 			}
-		}
-		else // if (ib_mt == IB_ARRAY || ib_mt == IB_MAP)
-		{
-			uint64_t count = 0; 
-			while (buf[*pos] != AI_BRKCD)
+
+			if (depth == st->cap)
 			{
-				int ret = cbor_verify(buf, size, pos);
+				ret = __cbor_verify_grow(st);
 				if (ret != CBOR_NO_ERROR)
 				{
 					return ret;
 				}
-
-				count++;
+				stack = st->frames;
 			}
 
-			if (ib_mt == IB_MAP && count % 2 == 1)
+			stack[depth++] = frame;
+			frame.ib_mt = ib_mt;
+			frame.indef = ib_ai == AI_INDEF;
+			frame.remaining = ib_mt == IB_TAG ? 1 : val;
+			frame.count = 0;
+		}
+		else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+		{
+			if (val > size - *pos)
 			{
-				return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+				return CBOR_ERR_OUT_OF_DATA;
 			}
+
+			*pos += val;
 		}
-		++*pos;
-		return CBOR_NO_ERROR;
 	}
 }
 
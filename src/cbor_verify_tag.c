@@ -23,9 +23,14 @@
 ****************************************************************************/
 
 #include "cbor.h"
+#include "cbor_header.h"
 
 int cbor_verify_tag(const uint8_t *buf, size_t size, size_t *pos, uint64_t tag)
 {
-	(void) tag;
+	int ret = __cbor_typed_array_check(buf, size, *pos, tag);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
 	return cbor_verify(buf, size, pos);
 }
@@ -0,0 +1,625 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "cbor.h"
+#include "cbor_header.h"
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// longest header: initial byte and an 8-byte argument
+#define CBOR_HEADER_MAX										9
+// longest UTF-8 sequence
+#define CBOR_UTF8_SEQ_MAX									4
+#define CBOR_WRITER_INITIAL_SIZE							256
+#define CBOR_WRITER_CHUNK_SIZE								4096
+
+static int __cbor_reserve_fixed(cbor_writer_t *writer, size_t need)
+{
+	(void) writer;
+	(void) need;
+	return CBOR_ERR_OUT_OF_MEMORY;
+}
+
+static int __cbor_reserve_heap(cbor_writer_t *writer, size_t need)
+{
+	// double the buffer, appends stay amortized O(1)
+	size_t size = writer->size > 0 ? writer->size : CBOR_WRITER_INITIAL_SIZE;
+	while (size - writer->pos < need)
+	{
+		if (size > ((size_t)-1) / 2)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+		size <<= 1;
+	}
+
+	const cbor_allocator_t *allocator = writer->allocator;
+	uint8_t *buf = writer->buf == NULL \
+		? (uint8_t *)allocator->alloc(allocator->ctx, size) \
+		: (uint8_t *)allocator->realloc(allocator->ctx, writer->buf, writer->size, size);
+	if (buf == NULL)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	writer->buf = buf;
+	writer->size = size;
+	return CBOR_NO_ERROR;
+}
+
+// drains the buffer, need is at most a header here, longer payloads bypass it
+static int __cbor_reserve_flush(cbor_writer_t *writer, size_t need)
+{
+	(void) need;
+	return cbor_writer_flush(writer);
+}
+
+static inline int __cbor_writer_reserve(cbor_writer_t *writer, size_t need)
+{
+	return (writer->size - writer->pos >= need) ? CBOR_NO_ERROR : writer->reserve(writer, need);
+}
+
+// ends the entry of buf written since the last reference, then references bytes
+static int __cbor_writer_splice(cbor_writer_t *writer, const void *bytes, size_t len)
+{
+	size_t need = writer->pos > writer->iov_mark ? 2 : 1;
+	if (writer->iov_cap - writer->iov_len < need)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	if (need == 2)
+	{
+		writer->iov[writer->iov_len].iov_base = writer->buf + writer->iov_mark;
+		writer->iov[writer->iov_len++].iov_len = writer->pos - writer->iov_mark;
+		writer->iov_mark = writer->pos;
+	}
+
+	writer->iov[writer->iov_len].iov_base = (void *)bytes;
+	writer->iov[writer->iov_len++].iov_len = len;
+	return CBOR_NO_ERROR;
+}
+
+int __cbor_writer_put(cbor_writer_t *writer, const void *bytes, size_t len)
+{
+	if (writer->iov != NULL && len >= writer->iov_threshold && len > 0)
+	{
+		return __cbor_writer_splice(writer, bytes, len);
+	}
+
+	if (writer->size - writer->pos < len)
+	{
+		int ret = writer->reserve(writer, len);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		// payloads larger than the buffer of a flushing writer are handed over in place
+		if (writer->size - writer->pos < len)
+		{
+			writer->flushed += len;
+			return writer->flush(writer->ctx, (const uint8_t *)bytes, len);
+		}
+	}
+
+	if (len > 0)
+	{
+		memcpy(writer->buf + writer->pos, bytes, len);
+		writer->pos += len;
+	}
+	return CBOR_NO_ERROR;
+}
+
+int __cbor_writer_copy(cbor_writer_t *writer, const void *bytes, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)bytes;
+	while (writer->size - writer->pos < len)
+	{
+		int ret = writer->reserve(writer, len);
+		if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		// a flushing writer takes the bytes a buffer at a time
+		size_t room = writer->size - writer->pos;
+		if (room >= len)
+		{
+			break;
+		}
+
+		memcpy(writer->buf + writer->pos, p, room);
+		writer->pos += room;
+		p += room;
+		len -= room;
+	}
+
+	if (len > 0)
+	{
+		memcpy(writer->buf + writer->pos, p, len);
+		writer->pos += len;
+	}
+	return CBOR_NO_ERROR;
+}
+
+// room for the longest header is the fast path, a nearly full buffer only needs the exact length
+static inline int __cbor_writer_reserve_item(cbor_writer_t *writer, size_t len)
+{
+	return (writer->size - writer->pos >= CBOR_HEADER_MAX) ? CBOR_NO_ERROR : __cbor_writer_reserve(writer, len);
+}
+
+static int __cbor_write_header(cbor_writer_t *writer, uint8_t ib_mt, uint64_t val)
+{
+	int ret = __cbor_writer_reserve_item(writer, cbor_encoded_size_header(val));
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return cbor_encode_header(writer->buf, writer->size, &writer->pos, ib_mt, val);
+}
+
+static int __cbor_write_bytes(cbor_writer_t *writer, uint8_t ib_mt, const void *bytes, size_t len)
+{
+	int ret = __cbor_write_header(writer, ib_mt, len);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return __cbor_writer_put(writer, bytes, len);
+}
+
+static int __cbor_write_byte(cbor_writer_t *writer, uint8_t ib)
+{
+	int ret = __cbor_writer_reserve(writer, 1);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	writer->buf[writer->pos++] = ib;
+	return CBOR_NO_ERROR;
+}
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buf, size_t size)
+{
+	writer->buf = buf;
+	writer->size = size;
+	writer->pos = 0;
+	writer->reserve = __cbor_reserve_fixed;
+	writer->flush = NULL;
+	writer->ctx = NULL;
+	writer->allocator = NULL;
+	writer->fd = -1;
+	writer->flushed = 0;
+	writer->iov = NULL;
+	writer->iov_cap = 0;
+	writer->iov_len = 0;
+	writer->iov_threshold = 0;
+	writer->iov_mark = 0;
+}
+
+int cbor_writer_init_heap(cbor_writer_t *writer, size_t size)
+{
+	return cbor_writer_init_heap_with(writer, size, NULL);
+}
+
+int cbor_writer_init_heap_with(cbor_writer_t *writer, size_t size, const cbor_allocator_t *allocator)
+{
+	cbor_writer_init(writer, NULL, 0);
+	writer->reserve = __cbor_reserve_heap;
+	writer->allocator = allocator != NULL ? allocator : cbor_get_allocator();
+	return size > 0 ? __cbor_reserve_heap(writer, size) : CBOR_NO_ERROR;
+}
+
+int cbor_writer_init_flush(cbor_writer_t *writer, uint8_t *buf, size_t size, int (*flush)(void *ctx, const uint8_t *buf, size_t len), void *ctx)
+{
+	cbor_writer_init(writer, buf, size);
+	if (size < CBOR_HEADER_MAX)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	writer->reserve = __cbor_reserve_flush;
+	writer->flush = flush;
+	writer->ctx = ctx;
+	return CBOR_NO_ERROR;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static int __cbor_flush_fd(void *ctx, const uint8_t *buf, size_t len)
+{
+	cbor_writer_t *writer = (cbor_writer_t *)ctx;
+	while (len > 0)
+	{
+		ssize_t n = write(writer->fd, buf, len);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return CBOR_ERR_IO;
+		}
+
+		buf += n;
+		len -= n;
+	}
+	return CBOR_NO_ERROR;
+}
+
+int cbor_writer_init_fd(cbor_writer_t *writer, uint8_t *buf, size_t size, int fd)
+{
+	int ret = cbor_writer_init_flush(writer, buf, size, __cbor_flush_fd, writer);
+	writer->fd = fd;
+	return ret;
+}
+#endif
+
+int cbor_writer_init_iovec(cbor_writer_t *writer, uint8_t *buf, size_t size, cbor_iovec_t *iov, size_t cap, size_t threshold)
+{
+	// buf never moves, entries may point into it
+	cbor_writer_init(writer, buf, size);
+	writer->iov = iov;
+	writer->iov_cap = cap;
+	writer->iov_threshold = threshold;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_writer_iovec_finish(cbor_writer_t *writer, size_t *iovcnt)
+{
+	if (writer->pos > writer->iov_mark)
+	{
+		if (writer->iov_len == writer->iov_cap)
+		{
+			return CBOR_ERR_OUT_OF_MEMORY;
+		}
+
+		writer->iov[writer->iov_len].iov_base = writer->buf + writer->iov_mark;
+		writer->iov[writer->iov_len++].iov_len = writer->pos - writer->iov_mark;
+		writer->iov_mark = writer->pos;
+	}
+
+	*iovcnt = writer->iov_len;
+	return CBOR_NO_ERROR;
+}
+
+int cbor_writer_flush(cbor_writer_t *writer)
+{
+	if (writer->flush == NULL || writer->pos == 0)
+	{
+		return CBOR_NO_ERROR;
+	}
+
+	size_t len = writer->pos;
+	writer->pos = 0;
+	writer->flushed += len;
+	return writer->flush(writer->ctx, writer->buf, len);
+}
+
+void cbor_writer_free(cbor_writer_t *writer)
+{
+	if (writer->reserve == __cbor_reserve_heap)
+	{
+		if (writer->buf != NULL)
+		{
+			writer->allocator->free(writer->allocator->ctx, writer->buf, writer->size);
+		}
+		writer->buf = NULL;
+		writer->size = 0;
+		writer->pos = 0;
+	}
+}
+
+int cbor_write_int(cbor_writer_t *writer, int64_t val)
+{
+	return (val & 0x8000000000000000) \
+		? __cbor_write_header(writer, IB_NEGINT, ~val) \
+		: __cbor_write_header(writer, IB_UINT, val);
+}
+
+int cbor_write_uint(cbor_writer_t *writer, uint64_t val)
+{
+	return __cbor_write_header(writer, IB_UINT, val);
+}
+
+int cbor_write_tag(cbor_writer_t *writer, uint64_t val)
+{
+	return __cbor_write_header(writer, IB_TAG, val);
+}
+
+int cbor_write_simple(cbor_writer_t *writer, uint8_t val)
+{
+	int ret = __cbor_writer_reserve(writer, cbor_encoded_size_simple(val));
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return cbor_encode_simple(writer->buf, writer->size, &writer->pos, val);
+}
+
+int cbor_write_float(cbor_writer_t *writer, double val)
+{
+	int ret = __cbor_writer_reserve_item(writer, cbor_encoded_size_float(val));
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return cbor_encode_float(writer->buf, writer->size, &writer->pos, val);
+}
+
+int cbor_write_bytes(cbor_writer_t *writer, const uint8_t *bytes, size_t len)
+{
+	return __cbor_write_bytes(writer, IB_BYTES, bytes, len);
+}
+
+int cbor_write_bytes_indef(cbor_writer_t *writer)
+{
+	return __cbor_write_byte(writer, IB_BYTES | AI_INDEF);
+}
+
+int cbor_write_string(cbor_writer_t *writer, const char *str)
+{
+	return __cbor_write_bytes(writer, IB_STRING, str, strlen(str));
+}
+
+int cbor_write_string_n(cbor_writer_t *writer, const char *str, size_t len)
+{
+	return __cbor_write_bytes(writer, IB_STRING, str, len);
+}
+
+int cbor_write_string_indef(cbor_writer_t *writer)
+{
+	return __cbor_write_byte(writer, IB_STRING | AI_INDEF);
+}
+
+int cbor_write_array(cbor_writer_t *writer, size_t len)
+{
+	return __cbor_write_header(writer, IB_ARRAY, len);
+}
+
+int cbor_write_array_indef(cbor_writer_t *writer)
+{
+	return __cbor_write_byte(writer, IB_ARRAY | AI_INDEF);
+}
+
+int cbor_write_map(cbor_writer_t *writer, size_t len)
+{
+	return __cbor_write_header(writer, IB_MAP, len << 1);
+}
+
+int cbor_write_map_indef(cbor_writer_t *writer)
+{
+	return __cbor_write_byte(writer, IB_MAP | AI_INDEF);
+}
+
+int cbor_write_break(cbor_writer_t *writer)
+{
+	return __cbor_write_byte(writer, AI_BRKCD);
+}
+
+int cbor_write_raw(cbor_writer_t *writer, const uint8_t *buf, size_t len)
+{
+	return __cbor_writer_put(writer, buf, len);
+}
+
+int cbor_write_typed_array(cbor_writer_t *writer, uint64_t tag, const void *data, size_t count)
+{
+	size_t width = cbor_typed_array_width(tag);
+	if (width == 0)
+	{
+		return CBOR_ERR_INVALID_TAG_CONTENT;
+	}
+
+	if (count > ((size_t)-1) / width)
+	{
+		return CBOR_ERR_OUT_OF_MEMORY;
+	}
+
+	int ret = __cbor_write_header(writer, IB_TAG, tag);
+	if (ret == CBOR_NO_ERROR)
+	{
+		ret = __cbor_write_header(writer, IB_BYTES, count * width);
+	}
+
+	if (ret != CBOR_NO_ERROR || __cbor_typed_array_native(tag))
+	{
+		return ret != CBOR_NO_ERROR ? ret : __cbor_writer_put(writer, data, count * width);
+	}
+
+	// swapped through the buffer, as many elements as fit at a time
+	const uint8_t *src = (const uint8_t *)data;
+	while (count > 0)
+	{
+		if (writer->size - writer->pos < width)
+		{
+			ret = writer->reserve(writer, count * width);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+
+		size_t n = (writer->size - writer->pos) / width;
+		if (n == 0)
+		{
+			// a flush buffer shorter than one element takes it in pieces
+			uint8_t tmp[16];
+			__cbor_typed_array_swap(tmp, src, width, 1);
+			ret = __cbor_writer_copy(writer, tmp, width);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+			src += width;
+			count--;
+			continue;
+		}
+
+		n = n < count ? n : count;
+		__cbor_typed_array_swap(writer->buf + writer->pos, src, width, n);
+		writer->pos += n * width;
+		src += n * width;
+		count -= n;
+	}
+	return CBOR_NO_ERROR;
+}
+
+// length of the incomplete UTF-8 sequence at the end of str
+static size_t __cbor_utf8_tail(const uint8_t *str, size_t len)
+{
+	for (size_t i = 1; i <= 3 && i <= len; i++)
+	{
+		uint8_t c = str[len - i];
+		if ((c & 0xc0) != 0x80)
+		{
+			size_t seq = (c >= 0xf0) ? 4 \
+				: (c >= 0xe0) ? 3 \
+				: (c >= 0xc0) ? 2 \
+				: 1;
+			return seq > i ? i : 0;
+		}
+	}
+	return 0;
+}
+
+static int __cbor_write_stream(cbor_writer_t *writer, uint8_t ib_mt, int (*read)(void *ctx, uint8_t *buf, size_t len, size_t *got), void *ctx, size_t chunk)
+{
+	uint8_t carry[3];
+	size_t carry_len = 0;
+	bool eof = false;
+	// a text chunk has room for the longest UTF-8 sequence, so each one makes progress
+	size_t min = ib_mt == IB_STRING ? CBOR_UTF8_SEQ_MAX : 1;
+	chunk = chunk > 0 ? chunk : CBOR_WRITER_CHUNK_SIZE;
+	chunk = chunk > min ? chunk : min;
+
+	int ret = __cbor_write_byte(writer, ib_mt | AI_INDEF);
+	while (ret == CBOR_NO_ERROR && (!eof || carry_len > 0))
+	{
+		// a fixed buffer takes whatever shorter chunk still fits
+		if (writer->size - writer->pos < CBOR_HEADER_MAX + chunk)
+		{
+			ret = writer->reserve(writer, CBOR_HEADER_MAX + chunk);
+			if (writer->size - writer->pos < CBOR_HEADER_MAX + min)
+			{
+				return ret != CBOR_NO_ERROR ? ret : CBOR_ERR_OUT_OF_MEMORY;
+			}
+			ret = CBOR_NO_ERROR;
+		}
+
+		size_t len = writer->size - writer->pos - CBOR_HEADER_MAX;
+		len = len < chunk ? len : chunk;
+
+		// the data is read right behind the longest header it may need, no staging copy
+		size_t head = cbor_encoded_size_header(len);
+		uint8_t *data = writer->buf + writer->pos + head;
+		memcpy(data, carry, carry_len);
+		size_t got = carry_len;
+		carry_len = 0;
+		while (!eof && got < len)
+		{
+			size_t n = 0;
+			ret = read(ctx, data + got, len - got, &n);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+
+			eof = n == 0;
+			got += n;
+		}
+
+		if (ib_mt == IB_STRING && !eof)
+		{
+			// got is at least CBOR_UTF8_SEQ_MAX here, so complete sequences remain in front of the tail
+			carry_len = __cbor_utf8_tail(data, got);
+			got -= carry_len;
+			memcpy(carry, data + got, carry_len);
+		}
+
+		if (got == 0)
+		{
+			// only at the end of the input
+			continue;
+		}
+
+		if (cbor_encoded_size_header(got) < head)
+		{
+			head = cbor_encoded_size_header(got);
+			memmove(writer->buf + writer->pos + head, data, got);
+		}
+		ret = cbor_encode_header(writer->buf, writer->size, &writer->pos, ib_mt, got);
+		writer->pos += got;
+	}
+
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+	return __cbor_write_byte(writer, AI_BRKCD);
+}
+
+int cbor_write_bytes_stream(cbor_writer_t *writer, int (*read)(void *ctx, uint8_t *buf, size_t len, size_t *got), void *ctx, size_t chunk)
+{
+	return __cbor_write_stream(writer, IB_BYTES, read, ctx, chunk);
+}
+
+int cbor_write_string_stream(cbor_writer_t *writer, int (*read)(void *ctx, uint8_t *buf, size_t len, size_t *got), void *ctx, size_t chunk)
+{
+	return __cbor_write_stream(writer, IB_STRING, read, ctx, chunk);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static int __cbor_read_fd(void *ctx, uint8_t *buf, size_t len, size_t *got)
+{
+	int fd = *(int *)ctx;
+	for (;;)
+	{
+		ssize_t n = read(fd, buf, len);
+		if (n >= 0)
+		{
+			*got = n;
+			return CBOR_NO_ERROR;
+		}
+
+		if (errno != EINTR)
+		{
+			return CBOR_ERR_IO;
+		}
+	}
+}
+
+int cbor_write_bytes_fd(cbor_writer_t *writer, int fd, size_t chunk)
+{
+	return __cbor_write_stream(writer, IB_BYTES, __cbor_read_fd, &fd, chunk);
+}
+
+int cbor_write_string_fd(cbor_writer_t *writer, int fd, size_t chunk)
+{
+	return __cbor_write_stream(writer, IB_STRING, __cbor_read_fd, &fd, chunk);
+}
+#endif
@@ -21,17 +21,27 @@
 ** THE SOFTWARE.
 **
 ****************************************************************************/
-
 #ifndef ENDIAN_H
 #define ENDIAN_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "fp16.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// byte order is fixed at compile time where the compiler tells, otherwise probed
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ENDIAN_LITTLE			1
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ENDIAN_LITTLE			0
+#elif defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__) || defined(__aarch64__)
+#define ENDIAN_LITTLE			1
+#endif
+
 #define ntohs(n)				endian_swap16(n)
 #define ntohl(n)				endian_swap32(n)
 #define ntohll(n)				endian_swap64(n)
@@ -40,36 +50,157 @@ extern "C" {
 #define htonl(n)				endian_swap32(n)
 #define htonll(n)				endian_swap64(n)
 
+static inline bool is_little_endian()
+{
+#ifdef ENDIAN_LITTLE
+	return ENDIAN_LITTLE;
+#else
+	const uint16_t one = 1;
+	uint8_t c;
+	memcpy(&c, &one, 1);
+	return c == 1;
+#endif
+}
 
-uint16_t endian_swap16(uint16_t n);
-uint32_t endian_swap32(uint32_t n);
-uint64_t endian_swap64(uint64_t n);
+// unconditional byte reversal
+static inline uint16_t endian_reverse16(uint16_t n)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_bswap16(n);
+#else
+	return (uint16_t)((n >> 8) | (n << 8));
+#endif
+}
+
+static inline uint32_t endian_reverse32(uint32_t n)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_bswap32(n);
+#else
+	n = ((n & 0xff00ff00) >> 8) | ((n & 0x00ff00ff) << 8);
+	return (n >> 16) | (n << 16);
+#endif
+}
+
+static inline uint64_t endian_reverse64(uint64_t n)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_bswap64(n);
+#else
+	n = ((n & 0xff00ff00ff00ff00) >> 8) | ((n & 0x00ff00ff00ff00ff) << 8);
+	n = ((n & 0xffff0000ffff0000) >> 16) | ((n & 0x0000ffff0000ffff) << 16);
+	return (n >> 32) | (n << 32);
+#endif
+}
+
+// between host and network byte order
+static inline uint16_t endian_swap16(uint16_t n)
+{
+	return is_little_endian() ? endian_reverse16(n) : n;
+}
+
+static inline uint32_t endian_swap32(uint32_t n)
+{
+	return is_little_endian() ? endian_reverse32(n) : n;
+}
+
+static inline uint64_t endian_swap64(uint64_t n)
+{
+	return is_little_endian() ? endian_reverse64(n) : n;
+}
+
+// unaligned loads and stores compile to single moves, byte swaps to bswap or movbe
 
 // network bytes to short
-uint16_t nbtos(const uint8_t *p);
+static inline uint16_t nbtos(const uint8_t *p)
+{
+	uint16_t u;
+	memcpy(&u, p, sizeof(uint16_t));
+	return ntohs(u);
+}
+
 // network bytes to long
-uint32_t nbtol(const uint8_t *p);
+static inline uint32_t nbtol(const uint8_t *p)
+{
+	uint32_t u;
+	memcpy(&u, p, sizeof(uint32_t));
+	return ntohl(u);
+}
+
 // network bytes to long long
-uint64_t nbtoll(const uint8_t *p);
+static inline uint64_t nbtoll(const uint8_t *p)
+{
+	uint64_t u;
+	memcpy(&u, p, sizeof(uint64_t));
+	return ntohll(u);
+}
+
 // network bytes to float16
-half nbtoh(const uint8_t *p);
+static inline half nbtoh(const uint8_t *p)
+{
+	return (half)nbtos(p);
+}
+
 // network bytes to float
-float nbtof(const uint8_t *p);
+static inline float nbtof(const uint8_t *p)
+{
+	uint32_t u = nbtol(p);
+	float f;
+	memcpy(&f, &u, sizeof(float));
+	return f;
+}
+
 // network bytes to double
-double nbtod(const uint8_t *p);
+static inline double nbtod(const uint8_t *p)
+{
+	uint64_t u = nbtoll(p);
+	double d;
+	memcpy(&d, &u, sizeof(double));
+	return d;
+}
 
 // short to network bytes
-void stonb(uint16_t s, uint8_t *p);
+static inline void stonb(uint16_t s, uint8_t *p)
+{
+	uint16_t u = htons(s);
+	memcpy(p, &u, sizeof(uint16_t));
+}
+
 // long to network bytes
-void ltonb(uint32_t l, uint8_t *p);
+static inline void ltonb(uint32_t l, uint8_t *p)
+{
+	uint32_t u = htonl(l);
+	memcpy(p, &u, sizeof(uint32_t));
+}
+
 // long long to network bytes
-void lltonb(uint64_t ll, uint8_t *p);
+static inline void lltonb(uint64_t ll, uint8_t *p)
+{
+	uint64_t u = htonll(ll);
+	memcpy(p, &u, sizeof(uint64_t));
+}
+
 // float16 to nework bytes
-void htonb(half h, uint8_t *p);
+static inline void htonb(half h, uint8_t *p)
+{
+	stonb((uint16_t)h, p);
+}
+
 // float to nework bytes
-void ftonb(float f, uint8_t *p);
+static inline void ftonb(float f, uint8_t *p)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(uint32_t));
+	ltonb(u, p);
+}
+
 // double to nework bytes
-void dtonb(double d, uint8_t *p);
+static inline void dtonb(double d, uint8_t *p)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(uint64_t));
+	lltonb(u, p);
+}
 
 #ifdef __cplusplus
 }
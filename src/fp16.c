@@ -1,53 +1,56 @@
 #include "fp16.h"
 #include <math.h>
+#include <string.h>
 
-float htof(half h)
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FP16_F16C
+#include <immintrin.h>
+#endif
+
+static inline float __fp16_float(uint32_t bits)
 {
-	uint16_t *p = (uint16_t *)(&h);
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
 
-	uint32_t fval = 0;
-	fval |= (*p & 0x8000) << 16;				// sign
+static inline uint32_t __fp16_bits(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
 
-	uint32_t mant = *p & 0x03ff;
-	uint32_t exp = (*p & 0x7c00) >> 10;			// exponential
+static inline float __htof(half h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t mant = h & 0x03ff;
+	uint32_t exp = (h & 0x7c00) >> 10;			// exponential
 	if (exp == 0x1f)							// NaN or Infinity
 	{
-		fval |= mant ? 0x7fc00000 : 0x7f800000;
+		return __fp16_float(sign | (mant ? 0x7fc00000 : 0x7f800000));
 	}
 	else if (exp > 0)							// normalized
 	{
-		fval |= (exp + 0x70) << 23;
-		if (mant != 0)
-		{
-			fval |= mant << 13;
-		}
-	}
-	else if (mant != 0)							// denormarlized
-	{
-		for (int i = 9; i >= 0; i--)
-		{
-			if (mant & (1 << i))
-			{
-				fval |= ((0x67 + i) << 23) | ((mant << (23 - i)) & 0x7fffff);
-				break;
-			}
-		}
-	}
-	// else;									// 0.0, -0.0
-	
-	return *((float *)&fval);
+		return __fp16_float(sign | ((exp + 0x70) << 23) | (mant << 13));
+	}
+
+	// denormalized, 0.0 and -0.0 are mant * 2^-24, exact in a float
+	return __fp16_float(sign | __fp16_bits((float)mant * 0x1p-24f));
 }
 
-half ftoh(float f)
+static inline half __ftoh(float f)
 {
-	uint32_t *p = (uint32_t *)(&f);
-
-	uint16_t hval = 0;
-	hval |= (*p >> 16) & 0x8000;				// sign
+	uint32_t fval = __fp16_bits(f);
 
-	int32_t mant = *p & 0x7fffff;
-	uint16_t exp = (*p >> 23) & 0xff;
-	if (exp == 0xff)							// NaN or Infinity
+	uint16_t hval = (fval >> 16) & 0x8000;		// sign
+	uint32_t mant = fval & 0x7fffff;
+	uint32_t exp = (fval >> 23) & 0xff;
+	if (exp - 0x71 < 0x1e)						// normalized
+	{
+		hval |= ((exp - 0x70) << 10) | (mant >> 13);
+	}
+	else if (exp == 0xff)						// NaN or Infinity
 	{
 		hval |= mant ? 0x7e00 : 0x7c00;
 	}
@@ -55,45 +58,129 @@ half ftoh(float f)
 	{
 		hval |= 0x7c00;
 	}
-	else if (exp >= 0x71)						// normalized
-	{
-		hval |= ((exp - 0x70) << 10) | (mant >> 13);
-	}
 	else if (exp >= 0x67)						// denormalized
 	{
 		hval |= (mant | 0x800000) >> (0x7e - exp);
 	}
 	// else;									// 0.0, -0.0 or loss of precision
 
-	return *((half *)&hval);
+	return hval;
+}
+
+float htof(half h)
+{
+	return __htof(h);
+}
+
+half ftoh(float f)
+{
+	return __ftoh(f);
 }
 
 bool is_ftoh_loss(float f)
 {
-	if (f == 0.0 || !isfinite(f) || isnan(f))
+	uint32_t fval = __fp16_bits(f);
+	uint32_t mant = fval & 0x7fffff;
+	uint32_t exp = (fval >> 23) & 0xff;
+	if (exp - 0x71 < 0x1e)						// normalized, 10 of 23 mantissa bits kept
+	{
+		return (mant & 0x1fff) != 0;
+	}
+	else if (exp - 0x67 < 0x0a)					// denormalized, fewer kept
 	{
-		return false;
+		return (mant & ((1 << (0x7e - exp)) - 1)) != 0;
 	}
 
-	uint32_t *p = (uint32_t *)(&f);
-	int32_t mant = *p & 0x7fffff;
-	uint16_t exp = (*p >> 23) & 0xff;
+	// 0.0, -0.0, NaN and Infinity are kept, anything else is out of range
+	return exp != 0xff && (fval & 0x7fffffff) != 0;
+}
 
-	if (exp >= 0x71 && exp < 0x8f)
+#ifdef FP16_F16C
+static bool __fp16_has_f16c(void)
+{
+	// the avx bit also tells that the OS saves the ymm registers
+	return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+}
+
+__attribute__((target("avx,f16c")))
+static void __halfs_to_floats_f16c(const half *src, float *dest, size_t n)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 qnan = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fc00000));
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+
+		// NaN payloads are dropped as in htof()
+		__m256 nan = _mm256_cmp_ps(f, f, _CMP_UNORD_Q);
+		f = _mm256_blendv_ps(f, _mm256_or_ps(_mm256_and_ps(f, sign), qnan), nan);
+		_mm256_storeu_ps(dest + i, f);
+	}
+
+	for (; i < n; i++)
+	{
+		dest[i] = __htof(src[i]);
+	}
+}
+
+__attribute__((target("avx,f16c")))
+static void __floats_to_halfs_f16c(const float *src, half *dest, size_t n)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 inf = _mm256_set1_ps(INFINITY);
+	const __m256 qnan = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fc00000));
+	const __m256 limit = _mm256_set1_ps(65536.0f);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 f = _mm256_loadu_ps(src + i);
+		__m256 s = _mm256_and_ps(f, sign);
+
+		// truncation saturates at 65504, ftoh() overflows to Infinity and drops NaN payloads
+		__m256 ovf = _mm256_cmp_ps(_mm256_andnot_ps(sign, f), limit, _CMP_GE_OQ);
+		f = _mm256_blendv_ps(f, _mm256_or_ps(s, inf), ovf);
+		__m256 nan = _mm256_cmp_ps(f, f, _CMP_UNORD_Q);
+		f = _mm256_blendv_ps(f, _mm256_or_ps(s, qnan), nan);
+
+		_mm_storeu_si128((__m128i *)(dest + i), _mm256_cvtps_ph(f, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+	}
+
+	for (; i < n; i++)
+	{
+		dest[i] = __ftoh(src[i]);
+	}
+}
+#endif
+
+void halfs_to_floats(const half *src, float *dest, size_t n)
+{
+#ifdef FP16_F16C
+	if (__fp16_has_f16c())
 	{
-		if (!(mant & 0x1fff))
-		{
-			return false;
-		}
+		__halfs_to_floats_f16c(src, dest, n);
+		return;
 	}
+#endif
 
-	if (exp >= 0x67 && exp < 0x71)
+	for (size_t i = 0; i < n; i++)
 	{
-		if (!(mant & ((1 << (0x7e - exp)) - 1)))
-		{
-			return false;
-		}
+		dest[i] = __htof(src[i]);
 	}
+}
 
-	return true;
+void floats_to_halfs(const float *src, half *dest, size_t n)
+{
+#ifdef FP16_F16C
+	if (__fp16_has_f16c())
+	{
+		__floats_to_halfs_f16c(src, dest, n);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < n; i++)
+	{
+		dest[i] = __ftoh(src[i]);
+	}
 }
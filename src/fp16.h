@@ -25,6 +25,7 @@
 #ifndef FP16_H
 #define FP16_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -39,6 +40,10 @@ float htof(half h);
 half ftoh(float f);
 bool is_ftoh_loss(float f);
 
+// bulk htof() and ftoh() over n elements, with F16C when the processor has it
+void halfs_to_floats(const half *src, float *dest, size_t n);
+void floats_to_halfs(const float *src, half *dest, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
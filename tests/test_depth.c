@@ -0,0 +1,174 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+// nesting limits at the CBOR_MAX_DEPTH boundary: cbor_verify_depth() accepts CBOR_MAX_DEPTH levels below
+// the top-level item and rejects one more, and the parsers with fixed stacks have to agree
+
+#include "cbor.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DOC_MAX												1024
+
+typedef size_t (*__test_nest_t)(uint8_t *buf, size_t levels);
+
+static size_t __test_nest_arrays(uint8_t *buf, size_t levels)
+{
+	size_t pos = 0;
+	for (size_t i = 0; i < levels; i++)
+	{
+		buf[pos++] = IB_ARRAY | 1;
+	}
+	buf[pos++] = IB_UINT | 1;
+	return pos;
+}
+
+static size_t __test_nest_indef(uint8_t *buf, size_t levels)
+{
+	size_t pos = 0;
+	for (size_t i = 0; i < levels; i++)
+	{
+		buf[pos++] = (i % 2 ? IB_MAP : IB_ARRAY) | AI_INDEF;
+		if (i % 2)
+		{
+			buf[pos++] = IB_UINT | 1;
+		}
+	}
+	buf[pos++] = IB_UINT | 1;
+	for (size_t i = 0; i < levels; i++)
+	{
+		buf[pos++] = AI_BRKCD;
+	}
+	return pos;
+}
+
+static size_t __test_nest_tags(uint8_t *buf, size_t levels)
+{
+	size_t pos = 0;
+	for (size_t i = 0; i < levels; i++)
+	{
+		buf[pos++] = IB_TAG | 24;
+		buf[pos++] = 100;
+	}
+	buf[pos++] = IB_UINT | 1;
+	return pos;
+}
+
+static int __test_stream(const uint8_t *buf, size_t size, size_t piece)
+{
+	cbor_stream_t stream;
+	cbor_stream_init(&stream);
+	size_t off = 0;
+	int ret;
+	do
+	{
+		size_t len = size - off < piece ? size - off : piece;
+		size_t pos = 0, need;
+		ret = cbor_stream_feed(&stream, buf + off, len, &pos, &need);
+		off += pos;
+	} while (ret == CBOR_ERR_OUT_OF_DATA && off < size);
+	return ret;
+}
+
+// enters every container and tag down to the innermost item
+static int __test_reader(const uint8_t *buf, size_t size)
+{
+	cbor_reader_t reader;
+	cbor_reader_init(&reader, buf, size);
+	for (;;)
+	{
+		cbor_t item;
+		int ret = cbor_reader_next(&reader, &item);
+		if (ret == CBOR_ERR_END_OF_CONTAINER)
+		{
+			return CBOR_NO_ERROR;
+		}
+		else if (ret != CBOR_NO_ERROR)
+		{
+			return ret;
+		}
+
+		if (item.ct == CBOR_ARRAY || item.ct == CBOR_MAP || item.ct == CBOR_TAG)
+		{
+			ret = cbor_reader_enter_container(&reader);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+	}
+}
+
+static int __test_check(const char *what, size_t levels, int ret, int expect)
+{
+	if (ret != expect)
+	{
+		printf("%s, %zu levels: %s, expected %s\n", what, levels, cbor_get_error(ret), cbor_get_error(expect));
+		return 0;
+	}
+	return 1;
+}
+
+int main(void)
+{
+	static const __test_nest_t nests[] = { __test_nest_arrays, __test_nest_indef, __test_nest_tags };
+	static const char *names[] = { "arrays", "indefinite containers", "tags" };
+
+	uint8_t buf[DOC_MAX];
+	int ok = 1;
+	for (size_t n = 0; n < sizeof(nests) / sizeof(nests[0]); n++)
+	{
+		for (size_t levels = CBOR_MAX_DEPTH - 1; levels <= CBOR_MAX_DEPTH + 1; levels++)
+		{
+			size_t size = nests[n](buf, levels);
+			int expect = levels <= CBOR_MAX_DEPTH ? CBOR_NO_ERROR : CBOR_ERR_DEPTH_EXCEEDED;
+			char what[64];
+
+			size_t pos = 0;
+			snprintf(what, sizeof(what), "cbor_verify_depth %s", names[n]);
+			ok &= __test_check(what, levels, cbor_verify_depth(buf, size, &pos, CBOR_MAX_DEPTH), expect);
+
+			pos = 0;
+			snprintf(what, sizeof(what), "cbor_verify %s", names[n]);
+			ok &= __test_check(what, levels, cbor_verify(buf, size, &pos), CBOR_NO_ERROR);
+
+			pos = 0;
+			cbor_callbacks_t callbacks;
+			memset(&callbacks, 0, sizeof(callbacks));
+			snprintf(what, sizeof(what), "cbor_parse_events %s", names[n]);
+			ok &= __test_check(what, levels, cbor_parse_events(buf, size, &pos, &callbacks, NULL), expect);
+
+			snprintf(what, sizeof(what), "cbor_reader_enter_container %s", names[n]);
+			ok &= __test_check(what, levels, __test_reader(buf, size), expect);
+
+			snprintf(what, sizeof(what), "cbor_stream_feed %s", names[n]);
+			ok &= __test_check(what, levels, __test_stream(buf, size, size), expect);
+			snprintf(what, sizeof(what), "cbor_stream_feed bytewise %s", names[n]);
+			ok &= __test_check(what, levels, __test_stream(buf, size, 1), expect);
+		}
+	}
+
+	printf("%s\n", ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+// htof() and ftoh() against their definitions over all halves and all 2^32 floats, and the F16C bulk
+// conversions against them bit for bit
+
+#include "fp16.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FLOAT_BLOCK											(1 << 16)
+
+// the value of a half, with quiet NaNs of the same sign
+static uint32_t __test_half_value(half h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	int exp = (h >> 10) & 0x1f;
+	int mant = h & 0x3ff;
+	if (exp == 0x1f)
+	{
+		return sign | (mant ? 0x7fc00000 : 0x7f800000);
+	}
+
+	float f = exp == 0 ? ldexpf((float)mant, -24) : ldexpf((float)(0x400 | mant), exp - 25);
+	return sign | __fp16_bits(f);
+}
+
+static int __test_halfs_to_floats(void)
+{
+	static half src[0x10000];
+	static float dest[0x10000];
+	for (uint32_t i = 0; i < 0x10000; i++)
+	{
+		src[i] = (half)i;
+	}
+	halfs_to_floats(src, dest, 0x10000);
+#ifdef FP16_F16C
+	static float f16c[0x10000];
+	if (__fp16_has_f16c())
+	{
+		__halfs_to_floats_f16c(src, f16c, 0x10000);
+	}
+#endif
+
+	size_t failures = 0;
+	for (uint32_t i = 0; i < 0x10000; i++)
+	{
+		uint32_t expect = __test_half_value((half)i);
+		bool ok = __fp16_bits(__htof((half)i)) == expect && __fp16_bits(dest[i]) == expect;
+#ifdef FP16_F16C
+		ok = ok && (!__fp16_has_f16c() || __fp16_bits(f16c[i]) == expect);
+#endif
+		if (!ok && failures++ < 10)
+		{
+			printf("half 0x%04x: htof 0x%08x, bulk 0x%08x, expected 0x%08x\n", i, __fp16_bits(__htof((half)i)), __fp16_bits(dest[i]), expect);
+		}
+	}
+	return failures == 0;
+}
+
+// ftoh() truncates towards zero, overflows to Infinity and keeps NaNs quiet
+static bool __test_ftoh(float f, half h)
+{
+	uint32_t bits = __fp16_bits(f);
+	if ((h & 0x8000) != ((bits >> 16) & 0x8000))
+	{
+		return false;
+	}
+	if (isnan(f))
+	{
+		return (h & 0x7fff) == 0x7e00 && !is_ftoh_loss(f);
+	}
+
+	float mag = fabsf(f);
+	half hmag = h & 0x7fff;
+	if (mag >= 65536.0f)
+	{
+		return hmag == 0x7c00 && is_ftoh_loss(f) == isfinite(f);
+	}
+	return hmag < 0x7c00 && __htof(hmag) <= mag && mag < __htof((half)(hmag + 1)) && is_ftoh_loss(f) == (__htof(hmag) != mag);
+}
+
+static int __test_floats_to_halfs(void)
+{
+	float *src = (float *)malloc(FLOAT_BLOCK * sizeof(float));
+	half *dest = (half *)malloc(FLOAT_BLOCK * sizeof(half));
+	half *f16c = (half *)malloc(FLOAT_BLOCK * sizeof(half));
+	if (src == NULL || dest == NULL || f16c == NULL)
+	{
+		return 0;
+	}
+
+	size_t failures = 0;
+	for (uint64_t base = 0; base < ((uint64_t)1 << 32); base += FLOAT_BLOCK)
+	{
+		size_t n = ((uint64_t)1 << 32) - base < FLOAT_BLOCK ? (size_t)(((uint64_t)1 << 32) - base) : FLOAT_BLOCK;
+		for (size_t i = 0; i < n; i++)
+		{
+			src[i] = __fp16_float((uint32_t)(base + i));
+		}
+		floats_to_halfs(src, dest, n);
+#ifdef FP16_F16C
+		if (__fp16_has_f16c())
+		{
+			__floats_to_halfs_f16c(src, f16c, n);
+		}
+		else
+#endif
+		{
+			memcpy(f16c, dest, n * sizeof(half));
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			half h = __ftoh(src[i]);
+			if ((dest[i] != h || f16c[i] != h || !__test_ftoh(src[i], h)) && failures++ < 10)
+			{
+				printf("float 0x%08x: ftoh 0x%04x, bulk 0x%04x, f16c 0x%04x\n", (uint32_t)(base + i), h, dest[i], f16c[i]);
+			}
+		}
+	}
+
+	free(src);
+	free(dest);
+	free(f16c);
+	return failures == 0;
+}
+
+int main(void)
+{
+#ifdef FP16_F16C
+	printf("f16c: %s\n", __fp16_has_f16c() ? "yes" : "no, scalar only");
+#endif
+	int ok = __test_halfs_to_floats();
+	ok &= __test_floats_to_halfs();
+	printf("%s\n", ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
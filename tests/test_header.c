@@ -0,0 +1,136 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+// the table-driven header reader against the ternary chains it replaced, over every initial byte, every
+// truncation of its argument and buffers of at least and fewer than 9 bytes
+
+#include "cbor.h"
+#include "cbor_header.h"
+#include <stdio.h>
+#include <string.h>
+
+static int __test_read_header(const uint8_t *buf, size_t size, size_t *pos, uint8_t *ib_mt, uint8_t *ib_ai, uint64_t *val)
+{
+	if (!ensure_capacity(buf, size, *pos + 1))
+	{
+		return CBOR_ERR_OUT_OF_DATA;
+	}
+
+	if (buf[*pos] == AI_BRKCD)
+	{
+		return CBOR_ERR_BREAK_OUTSIDE_INDEF;
+	}
+
+	*ib_mt = buf[*pos] & 0xe0;
+	*ib_ai = buf[*pos] & 0x1f;
+	if (*ib_ai < 28)
+	{
+		size_t len = (*ib_ai == AI_1) ? 1 \
+			: (*ib_ai == AI_2) ? 2 \
+			: (*ib_ai == AI_4) ? 4 \
+			: (*ib_ai == AI_8) ? 8 \
+			: 0;
+		if (!ensure_capacity(buf, size, *pos + len + 1))
+		{
+			return CBOR_ERR_OUT_OF_DATA;
+		}
+
+		++*pos;
+		*val = (len == 1) ? buf[*pos] \
+			: (len == 2) ? nbtos(buf + *pos) \
+			: (len == 4) ? nbtol(buf + *pos) \
+			: (len == 8) ? nbtoll(buf + *pos) \
+			: *ib_ai;
+		*pos += len;
+		return CBOR_NO_ERROR;
+	}
+	else if (*ib_ai < AI_INDEF)
+	{
+		return CBOR_ERR_RESERVED_AI;
+	}
+	else // if (*ib_ai == AI_INDEF)
+	{
+		if (*ib_mt != IB_BYTES && *ib_mt != IB_STRING && *ib_mt != IB_ARRAY && *ib_mt != IB_MAP)
+		{
+			return CBOR_ERR_MT_UNDEF_FOR_INDEF;
+		}
+
+		if (!ensure_capacity(buf, size, *pos + 2))
+		{
+			return CBOR_ERR_OUT_OF_DATA;
+		}
+
+		++*pos;
+		*val = 0;
+		return CBOR_NO_ERROR;
+	}
+}
+
+int main(void)
+{
+	static const uint8_t args[][8] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff },
+		{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef },
+		{ 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 }
+	};
+
+	uint8_t buf[32];
+	size_t failures = 0, cases = 0;
+	for (unsigned ib = 0; ib < 256; ib++)
+	{
+		for (size_t a = 0; a < sizeof(args) / sizeof(args[0]); a++)
+		{
+			// the item at an offset, followed by a tail of up to 10 more bytes
+			for (size_t offset = 0; offset < 3; offset++)
+			{
+				for (size_t avail = 0; avail <= 11; avail++)
+				{
+					memset(buf, 0xa5, sizeof(buf));
+					buf[offset] = (uint8_t)ib;
+					memcpy(buf + offset + 1, args[a], sizeof(args[a]));
+					size_t size = offset + avail;
+
+					size_t pos = offset, expect_pos = offset;
+					uint8_t ib_mt = 0, ib_ai = 0, expect_mt = 0, expect_ai = 0;
+					uint64_t val = 0, expect_val = 0;
+					int ret = cbor_read_header(buf, size, &pos, &ib_mt, &ib_ai, &val);
+					int expect = __test_read_header(buf, size, &expect_pos, &expect_mt, &expect_ai, &expect_val);
+					cases++;
+
+					if (ret != expect || pos != expect_pos || (ret == CBOR_NO_ERROR && (ib_mt != expect_mt || ib_ai != expect_ai || val != expect_val)))
+					{
+						if (failures++ < 10)
+						{
+							printf("initial byte 0x%02x, %zu bytes: %s at %zu, expected %s at %zu\n", ib, avail, cbor_get_error(ret), pos, cbor_get_error(expect), expect_pos);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	printf("%zu cases, %s\n", cases, failures == 0 ? "passed" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
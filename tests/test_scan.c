@@ -0,0 +1,201 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 King Brain Infotech Co., Ltd.
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+// __cbor_scan_immediates() variants against the scalar loop, and cbor_verify() with its skipping of
+// immediate runs against an item-by-item verifier
+
+#include "cbor_scan.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_BUFFERS										200000
+
+static uint64_t __test_state = 0x9e3779b97f4a7c15;
+
+static uint64_t __test_random(void)
+{
+	__test_state ^= __test_state << 13;
+	__test_state ^= __test_state >> 7;
+	__test_state ^= __test_state << 17;
+	return __test_state;
+}
+
+// one item at a time, the verifier before immediate runs were skipped
+static int __test_verify_item(const uint8_t *buf, size_t size, size_t *pos)
+{
+	uint8_t ib_mt, ib_ai;
+	uint64_t val;
+	int ret = __cbor_read_header(buf, size, pos, &ib_mt, &ib_ai, &val);
+	if (ret != CBOR_NO_ERROR)
+	{
+		return ret;
+	}
+
+	if (ib_ai == AI_INDEF)
+	{
+		uint64_t count = 0;
+		for (;;)
+		{
+			if (!ensure_capacity(buf, size, *pos + 1))
+			{
+				return CBOR_ERR_OUT_OF_DATA;
+			}
+
+			if (buf[*pos] == AI_BRKCD)
+			{
+				break;
+			}
+
+			if ((ib_mt == IB_BYTES || ib_mt == IB_STRING) && (buf[*pos] & 0xe0) != ib_mt)
+			{
+				return CBOR_ERR_BYTES_TEXT_MISMATCH;
+			}
+
+			ret = __test_verify_item(buf, size, pos);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+			count++;
+		}
+
+		if (ib_mt == IB_MAP && count % 2 == 1)
+		{
+			return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+		}
+		++*pos;
+	}
+	else if (ib_mt == IB_ARRAY || ib_mt == IB_MAP || ib_mt == IB_TAG)
+	{
+		if (ib_mt == IB_MAP && val % 2 == 1)
+		{
+			return CBOR_ERR_ODD_SIZE_INDEF_MAP;
+		}
+
+		for (uint64_t i = 0; i < (ib_mt == IB_TAG ? 1 : val); i++)
+		{
+			ret = __test_verify_item(buf, size, pos);
+			if (ret != CBOR_NO_ERROR)
+			{
+				return ret;
+			}
+		}
+	}
+	else if (ib_mt == IB_BYTES || ib_mt == IB_STRING)
+	{
+		if (val > size - *pos)
+		{
+			return CBOR_ERR_OUT_OF_DATA;
+		}
+		*pos += val;
+	}
+	return CBOR_NO_ERROR;
+}
+
+// mostly immediates, with containers, strings and a few bytes of anything
+static uint8_t __test_random_byte(void)
+{
+	static const uint8_t others[] = { 0x18, 0x19, 0x39, 0x41, 0x62, 0x5f, 0x7f, 0x82, 0x84, 0x9f, 0xa2, 0xbf, 0xc1, 0xd8, 0xf9, 0xfa, 0xff };
+	uint64_t r = __test_random();
+	if (r % 8 < 5)
+	{
+		static const uint8_t mts[] = { IB_UINT, IB_NEGINT, IB_PRIM };
+		return mts[(r >> 8) % 3] | (uint8_t)((r >> 16) % 24);
+	}
+	return r % 8 < 7 ? others[(r >> 8) % sizeof(others)] : (uint8_t)(r >> 8);
+}
+
+static int __test_scan(void)
+{
+	uint8_t buf[160];
+	size_t failures = 0;
+	for (size_t n = 0; n < RANDOM_BUFFERS / 10; n++)
+	{
+		// long immediate runs broken at every position of a SIMD block
+		size_t len = __test_random() % sizeof(buf);
+		for (size_t i = 0; i < len; i++)
+		{
+			buf[i] = (uint8_t)((__test_random() % 24) | (__test_random() % 2 ? IB_PRIM : IB_UINT));
+		}
+		if (len > 0 && __test_random() % 4 != 0)
+		{
+			buf[__test_random() % len] = __test_random_byte();
+		}
+
+		for (size_t off = 0; off < 4 && off <= len; off++)
+		{
+			size_t expect = __cbor_scan_scalar(buf + off, len - off);
+			size_t got = __cbor_scan_immediates(buf + off, len - off);
+#ifdef CBOR_SCAN_X86
+			size_t sse2 = __cbor_scan_sse2(buf + off, len - off);
+			size_t avx2 = __builtin_cpu_supports("avx2") ? __cbor_scan_avx2(buf + off, len - off) : expect;
+#else
+			size_t sse2 = expect, avx2 = expect;
+#endif
+			if (got != expect || sse2 != expect || avx2 != expect)
+			{
+				if (failures++ < 10)
+				{
+					printf("scan: length %zu offset %zu: scalar %zu, dispatched %zu, sse2 %zu, avx2 %zu\n", len, off, expect, got, sse2, avx2);
+				}
+			}
+		}
+	}
+	return failures == 0;
+}
+
+static int __test_verify(void)
+{
+	uint8_t buf[256];
+	size_t failures = 0;
+	for (size_t n = 0; n < RANDOM_BUFFERS; n++)
+	{
+		size_t len = __test_random() % sizeof(buf);
+		for (size_t i = 0; i < len; i++)
+		{
+			buf[i] = __test_random_byte();
+		}
+
+		size_t pos = 0, expect_pos = 0;
+		int ret = cbor_verify(buf, len, &pos);
+		int expect = __test_verify_item(buf, len, &expect_pos);
+		if (ret != expect || pos != expect_pos)
+		{
+			if (failures++ < 10)
+			{
+				printf("verify: length %zu: %s at %zu, expected %s at %zu\n", len, cbor_get_error(ret), pos, cbor_get_error(expect), expect_pos);
+			}
+		}
+	}
+	return failures == 0;
+}
+
+int main(void)
+{
+	int ok = __test_scan();
+	ok &= __test_verify();
+	printf("%s\n", ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}